@@ -2,12 +2,119 @@
 #ifndef _ZIP_HPP_
 #define _ZIP_HPP_
 
+#include <algorithm>
+#include <cstddef>
 #include <iterator>
+#include <type_traits>
 
 #include "zip_internal.hpp"
 
 namespace zip {
 
+// A container interface to a contiguous array which it
+// does not own, so that raw buffers, such as the columns of
+// a memory mapped file, can be zipped. Span<const T> gives
+// read only columns
+// Span<const double> x(data, n);
+// for(auto [x_i, y_i] : make_zip(x, y)) {...}
+template <typename T>
+class Span {
+ public:
+  using element_type = T;
+  using value_type = std::remove_cv_t<T>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using reference = T &;
+  using const_reference = const T &;
+  using iterator = T *;
+  using const_iterator = const T *;
+
+  constexpr Span() noexcept = default;
+  constexpr Span(T *data, const size_type size) noexcept
+      : data_(data), size_(size) {}
+
+  constexpr T *data() const noexcept { return data_; }
+  constexpr size_type size() const noexcept { return size_; }
+  constexpr bool empty() const noexcept { return size_ == 0; }
+
+  constexpr iterator begin() const noexcept { return data_; }
+  constexpr iterator end() const noexcept {
+    return data_ + size_;
+  }
+  constexpr const_iterator cbegin() const noexcept {
+    return data_;
+  }
+  constexpr const_iterator cend() const noexcept {
+    return data_ + size_;
+  }
+
+  constexpr reference operator[](
+      const size_type i) const noexcept {
+    return data_[i];
+  }
+
+ protected:
+  T *data_ = nullptr;
+  size_type size_ = 0;
+};
+
+// A lightweight view over the subrange [first, last) of a
+// Zip. Only the pair of zip iterators is stored, so making
+// and copying a Slice never touches the underlying
+// containers; the same lifetime caveats as Zip apply
+//
+// Slices of a Zip can be handed to separate threads or
+// used to process a large zip in batches:
+// for(auto [t1, t2] : make_zip(vec_1, vec_2).take(64))
+// {...}
+template <typename iterator_>
+class Slice {
+ public:
+  using iterator = iterator_;
+  using value_type = typename iterator::value_type;
+  using reference = typename iterator::reference;
+  using pointer = typename iterator::pointer;
+  using size_type = typename iterator::size_type;
+  using difference_type = typename iterator::difference_type;
+
+  constexpr Slice(const iterator &first,
+                  const iterator &last) noexcept
+      : begin_(first), end_(last) {}
+
+  constexpr iterator begin() const noexcept {
+    return begin_;
+  }
+  constexpr iterator end() const noexcept { return end_; }
+
+  constexpr size_type size() const noexcept {
+    return static_cast<size_type>(end_ - begin_);
+  }
+  constexpr bool empty() const noexcept {
+    return begin_ == end_;
+  }
+
+  // Sub-slices; first and last are relative to this slice,
+  // and must satisfy first <= last <= size()
+  constexpr Slice slice(const size_type first,
+                        const size_type last) const noexcept {
+    return Slice(begin_ + static_cast<difference_type>(first),
+                 begin_ + static_cast<difference_type>(last));
+  }
+  // take and drop clamp n to the size of the slice
+  constexpr Slice take(const size_type n) const noexcept {
+    return slice(0, std::min(n, size()));
+  }
+  constexpr Slice drop(const size_type n) const noexcept {
+    return slice(std::min(n, size()), size());
+  }
+
+ protected:
+  iterator begin_;
+  iterator end_;
+};
+
 // The actual Zip iterator
 // WARNING: The lifetime of the Zip object is dependent on
 // the lifetime of the containers its constructed with
@@ -44,6 +151,13 @@ class Zip {
   using difference_type = typename std::tuple_element<
       0, std::tuple<containers_...>>::type::difference_type;
 
+  // The type of a Zip over a subset of these containers
+  template <std::size_t... columns_>
+  using projection =
+      Zip<iterator_tag_,
+          std::tuple_element_t<
+              columns_, std::tuple<containers_...>>...>;
+
   // Iterator
   template <typename... iterators_>
   class iterator_t {
@@ -88,20 +202,22 @@ class Zip {
       return std::get<0>(iters_) - std::get<0>(rhs.iters_);
     }
 
-    constexpr iterator_t &operator+=(const int s) noexcept {
+    constexpr iterator_t &operator+=(
+        const difference_type s) noexcept {
       zip_internal_::ref_tuple_transform(
           iters_, zip_internal_::iterator_add(s));
       return *this;
     }
 
-    constexpr iterator_t &operator-=(const int s) noexcept {
+    constexpr iterator_t &operator-=(
+        const difference_type s) noexcept {
       zip_internal_::ref_tuple_transform(
           iters_, zip_internal_::iterator_add(-s));
       return *this;
     }
 
     constexpr iterator_t operator+(
-        const int s) const noexcept {
+        const difference_type s) const noexcept {
       iterator_t new_iters = *this;
       zip_internal_::ref_tuple_transform(
           new_iters.iters_, zip_internal_::iterator_add(s));
@@ -109,7 +225,7 @@ class Zip {
     }
 
     constexpr iterator_t operator-(
-        const int s) const noexcept {
+        const difference_type s) const noexcept {
       iterator_t new_iters = *this;
       zip_internal_::ref_tuple_transform(
           new_iters.iters_,
@@ -174,15 +290,162 @@ class Zip {
       return !((*this - cmp) < 0);
     }
 
+    // The underlying iterators, one per column
+    constexpr const iterator_tuple &iterators() const noexcept {
+      return iters_;
+    }
+
+    // An iterator over a subset of the columns, positioned at
+    // the same element; only the selected iterators are
+    // copied
+    template <std::size_t... columns_>
+    constexpr auto project() const noexcept {
+      using projected_t =
+          typename projection<columns_...>::template iterator_t<
+              std::tuple_element_t<columns_,
+                                   iterator_tuple>...>;
+      return projected_t(std::make_tuple(
+          std::get<columns_>(iters_)...));
+    }
+
    protected:
     iterator_tuple iters_;
   };
 
+  // Reverse iterator
+  // Unlike std::reverse_iterator, which stores the position
+  // one past the element and decrements a copy of every
+  // column's iterator on each dereference, this stores the
+  // beginning of the zip and the index of the element, and
+  // dereferences by indexing each column directly. rend()
+  // has index -1, so no iterator before the beginning of
+  // the containers is ever formed
+  template <typename... iterators_>
+  class reverse_iterator_t {
+   public:
+    using iterator_type = iterator_t<iterators_...>;
+
+    using value_type = Zip::value_type;
+    using reference = typename iterator_type::reference;
+    using pointer = typename iterator_type::pointer;
+
+    using size_type = Zip::size_type;
+    using difference_type = Zip::difference_type;
+
+    using iterator_category = iterator_tag_;
+
+    // first is the beginning of the zip, and i the index of
+    // the element this iterator dereferences to
+    constexpr reverse_iterator_t(
+        const iterator_type &first,
+        const difference_type i) noexcept
+        : first_(first), i_(i) {}
+
+    constexpr reference operator*() const noexcept {
+      return zip_internal_::index_tuple<reference>(
+          first_.iterators(), i_);
+    }
+
+    // The forward iterator one past the current element,
+    // matching std::reverse_iterator::base
+    constexpr iterator_type base() const noexcept {
+      return first_ + (i_ + 1);
+    }
+
+    constexpr difference_type operator-(
+        const reverse_iterator_t &rhs) const noexcept {
+      return rhs.i_ - i_;
+    }
+
+    constexpr reverse_iterator_t &operator+=(
+        const difference_type s) noexcept {
+      i_ -= s;
+      return *this;
+    }
+
+    constexpr reverse_iterator_t &operator-=(
+        const difference_type s) noexcept {
+      i_ += s;
+      return *this;
+    }
+
+    constexpr reverse_iterator_t operator+(
+        const difference_type s) const noexcept {
+      return reverse_iterator_t(first_, i_ - s);
+    }
+
+    constexpr reverse_iterator_t operator-(
+        const difference_type s) const noexcept {
+      return reverse_iterator_t(first_, i_ + s);
+    }
+
+    constexpr reverse_iterator_t &operator++() noexcept {
+      --i_;
+      return *this;
+    }
+
+    constexpr reverse_iterator_t &operator--() noexcept {
+      ++i_;
+      return *this;
+    }
+
+    constexpr reverse_iterator_t operator++(int) noexcept {
+      const auto copy = *this;
+      --i_;
+      return copy;
+    }
+
+    constexpr reverse_iterator_t operator--(int) noexcept {
+      const auto copy = *this;
+      ++i_;
+      return copy;
+    }
+
+    constexpr bool operator==(
+        const reverse_iterator_t &cmp) const noexcept {
+      return i_ == cmp.i_;
+    }
+
+    constexpr bool operator!=(
+        const reverse_iterator_t &cmp) const noexcept {
+      return i_ != cmp.i_;
+    }
+
+    constexpr bool operator<(
+        const reverse_iterator_t &cmp) const noexcept {
+      return i_ > cmp.i_;
+    }
+
+    constexpr bool operator<=(
+        const reverse_iterator_t &cmp) const noexcept {
+      return i_ >= cmp.i_;
+    }
+
+    constexpr bool operator>(
+        const reverse_iterator_t &cmp) const noexcept {
+      return i_ < cmp.i_;
+    }
+
+    constexpr bool operator>=(
+        const reverse_iterator_t &cmp) const noexcept {
+      return i_ <= cmp.i_;
+    }
+
+   protected:
+    iterator_type first_;
+    difference_type i_;
+  };
+
   using const_iterator =
       iterator_t<typename containers_::const_iterator...>;
   using iterator =
       iterator_t<typename containers_::iterator...>;
 
+  using const_reverse_iterator = reverse_iterator_t<
+      typename containers_::const_iterator...>;
+  using reverse_iterator =
+      reverse_iterator_t<typename containers_::iterator...>;
+
   // Constructor - due to the lifetime constraints, rvalues
   // are not permitted as inputs, only lvalue references
   constexpr Zip() = delete;
@@ -219,6 +482,50 @@ class Zip {
                   zip_internal_::end_iterator_converter()));
   }
 
+  constexpr const_reverse_iterator crbegin() const noexcept {
+    return const_reverse_iterator(
+        cbegin(), static_cast<difference_type>(size()) - 1);
+  }
+  constexpr const_reverse_iterator crend() const noexcept {
+    return const_reverse_iterator(cbegin(), -1);
+  }
+
+  constexpr reverse_iterator rbegin() const noexcept {
+    return reverse_iterator(
+        begin(), static_cast<difference_type>(size()) - 1);
+  }
+  constexpr reverse_iterator rend() const noexcept {
+    return reverse_iterator(begin(), -1);
+  }
+
+  // A range over the zip from back to front
+  // for(auto [t1, t2] : make_zip(vec_1, vec_2).reversed())
+  // {...}
+  constexpr Slice<reverse_iterator> reversed() const noexcept {
+    return Slice<reverse_iterator>(rbegin(), rend());
+  }
+
+  // The number of elements in the first container; all of
+  // the containers are assumed to be the same size
+  constexpr size_type size() const noexcept {
+    return std::get<0>(contents_).size();
+  }
+
+  // O(1) views over part of the zip, see Slice
+  constexpr Slice<iterator> slice(
+      const size_type first,
+      const size_type last) const noexcept {
+    return Slice<iterator>(begin(), end()).slice(first, last);
+  }
+  constexpr Slice<iterator> take(
+      const size_type n) const noexcept {
+    return Slice<iterator>(begin(), end()).take(n);
+  }
+  constexpr Slice<iterator> drop(
+      const size_type n) const noexcept {
+    return Slice<iterator>(begin(), end()).drop(n);
+  }
+
   std::tuple<containers_ &...> contents_;
 };
 
@@ -230,6 +537,524 @@ auto make_zip(containers_ &... c) {
   return zip_t(c...);
 }
 
+// Column projection: a narrower Zip over the selected
+// containers of z, which are shared rather than copied.
+// Dereferencing and advancing the result only touches the
+// selected columns
+// auto pv = project<0, 3>(make_zip(pos, mass, charge, vel));
+template <std::size_t... columns_, typename iterator_tag_,
+          typename... containers_>
+constexpr auto project(
+    const Zip<iterator_tag_, containers_...> &z) noexcept {
+  using zip_t = typename Zip<iterator_tag_, containers_...>::
+      template projection<columns_...>;
+  return zip_t(std::get<columns_>(z.contents_)...);
+}
+
+template <std::size_t... columns_, typename iterator_>
+constexpr auto project(const Slice<iterator_> &s) noexcept {
+  auto first = s.begin().template project<columns_...>();
+  return Slice<decltype(first)>(
+      first, s.end().template project<columns_...>());
+}
+
+// A random access view of the rows of a zip in the order
+// given by a range of indices, so that element i of the view
+// is row indices[i] of the zip. Advancing an iterator of the
+// view only advances the index iterator, and dereferencing
+// it indexes each column directly, rather than building
+// begin() + indices[i] for every column. Writes through the
+// view go to the rows of the zip
+// for(auto [p, v] : gather(make_zip(pos, vel), cell_order))
+// {...}
+template <typename iterator_, typename index_iterator_>
+class Gather {
+ public:
+  using value_type = typename iterator_::value_type;
+  using reference = typename iterator_::reference;
+  using pointer = typename iterator_::pointer;
+  using size_type = typename iterator_::size_type;
+  using difference_type = typename iterator_::difference_type;
+
+  class iterator {
+   public:
+    using value_type = Gather::value_type;
+    using reference = Gather::reference;
+    using pointer = Gather::pointer;
+    using size_type = Gather::size_type;
+    using difference_type = Gather::difference_type;
+
+    using iterator_category = std::random_access_iterator_tag;
+
+    using iterator_tuple = typename iterator_::iterator_tuple;
+
+    constexpr iterator(const iterator_tuple &base,
+                       const index_iterator_ &index) noexcept
+        : base_(base), index_(index) {}
+
+    constexpr reference operator*() const noexcept {
+      return zip_internal_::index_tuple<reference>(
+          base_, static_cast<std::ptrdiff_t>(*index_));
+    }
+
+    constexpr reference operator[](
+        const difference_type s) const noexcept {
+      return zip_internal_::index_tuple<reference>(
+          base_, static_cast<std::ptrdiff_t>(index_[s]));
+    }
+
+    constexpr difference_type operator-(
+        const iterator &rhs) const noexcept {
+      return index_ - rhs.index_;
+    }
+
+    constexpr iterator &operator+=(
+        const difference_type s) noexcept {
+      index_ += s;
+      return *this;
+    }
+
+    constexpr iterator &operator-=(
+        const difference_type s) noexcept {
+      index_ -= s;
+      return *this;
+    }
+
+    constexpr iterator operator+(
+        const difference_type s) const noexcept {
+      return iterator(base_, index_ + s);
+    }
+
+    constexpr iterator operator-(
+        const difference_type s) const noexcept {
+      return iterator(base_, index_ - s);
+    }
+
+    constexpr iterator &operator++() noexcept {
+      ++index_;
+      return *this;
+    }
+
+    constexpr iterator &operator--() noexcept {
+      --index_;
+      return *this;
+    }
+
+    constexpr iterator operator++(int) noexcept {
+      const auto copy = *this;
+      ++index_;
+      return copy;
+    }
+
+    constexpr iterator operator--(int) noexcept {
+      const auto copy = *this;
+      --index_;
+      return copy;
+    }
+
+    constexpr bool operator==(
+        const iterator &cmp) const noexcept {
+      return index_ == cmp.index_;
+    }
+
+    constexpr bool operator!=(
+        const iterator &cmp) const noexcept {
+      return index_ != cmp.index_;
+    }
+
+    constexpr bool operator<(
+        const iterator &cmp) const noexcept {
+      return index_ < cmp.index_;
+    }
+
+    constexpr bool operator<=(
+        const iterator &cmp) const noexcept {
+      return index_ <= cmp.index_;
+    }
+
+    constexpr bool operator>(
+        const iterator &cmp) const noexcept {
+      return index_ > cmp.index_;
+    }
+
+    constexpr bool operator>=(
+        const iterator &cmp) const noexcept {
+      return index_ >= cmp.index_;
+    }
+
+   protected:
+    iterator_tuple base_;
+    index_iterator_ index_;
+  };
+
+  constexpr Gather(const iterator_ &base,
+                   const index_iterator_ &first,
+                   const index_iterator_ &last) noexcept
+      : base_(base.iterators()), first_(first), last_(last) {}
+
+  constexpr iterator begin() const noexcept {
+    return iterator(base_, first_);
+  }
+  constexpr iterator end() const noexcept {
+    return iterator(base_, last_);
+  }
+
+  constexpr size_type size() const noexcept {
+    return static_cast<size_type>(last_ - first_);
+  }
+
+  constexpr reference operator[](
+      const difference_type i) const noexcept {
+    return begin()[i];
+  }
+
+ protected:
+  typename iterator_::iterator_tuple base_;
+  index_iterator_ first_;
+  index_iterator_ last_;
+};
+
+// indices is a container of integral row numbers of z, which
+// must outlive the view
+template <typename zip_, typename indices_>
+constexpr auto gather(const zip_ &z,
+                      const indices_ &indices) noexcept {
+  return Gather<typename zip_::iterator,
+                typename indices_::const_iterator>(
+      z.begin(), std::cbegin(indices), std::cend(indices));
+}
+
+// A random access view of the rows of a zip in compressed
+// sparse row form, where a container of offsets splits the
+// zip into consecutive segments, and segment i is the Slice
+// of rows [offsets[i], offsets[i + 1]). The offsets
+// container has one more element than there are segments,
+// starting at 0 and ending at the size of the zip
+// Neighbor lists stored as offsets, neighbor_ids and
+// weights are iterated with
+// for(auto neighbors : segments(offsets,
+//                               make_zip(neighbor_ids,
+//                                        weights))) {
+//   for(auto [id, w] : neighbors) {...}
+// }
+template <typename iterator_, typename offset_iterator_>
+class Segments {
+ public:
+  using value_type = Slice<iterator_>;
+  using reference = value_type;
+  using size_type = typename iterator_::size_type;
+  using difference_type = typename iterator_::difference_type;
+
+  class iterator {
+   public:
+    using value_type = Segments::value_type;
+    using reference = Segments::reference;
+    using pointer = void;
+    using size_type = Segments::size_type;
+    using difference_type = Segments::difference_type;
+
+    using iterator_category = std::random_access_iterator_tag;
+
+    constexpr iterator(const iterator_ &base,
+                       const offset_iterator_ &offset) noexcept
+        : base_(base), offset_(offset) {}
+
+    constexpr reference operator*() const noexcept {
+      return (*this)[0];
+    }
+
+    constexpr reference operator[](
+        const difference_type s) const noexcept {
+      return reference(
+          base_ + static_cast<difference_type>(offset_[s]),
+          base_ + static_cast<difference_type>(offset_[s + 1]));
+    }
+
+    constexpr difference_type operator-(
+        const iterator &rhs) const noexcept {
+      return offset_ - rhs.offset_;
+    }
+
+    constexpr iterator &operator+=(
+        const difference_type s) noexcept {
+      offset_ += s;
+      return *this;
+    }
+
+    constexpr iterator &operator-=(
+        const difference_type s) noexcept {
+      offset_ -= s;
+      return *this;
+    }
+
+    constexpr iterator operator+(
+        const difference_type s) const noexcept {
+      return iterator(base_, offset_ + s);
+    }
+
+    constexpr iterator operator-(
+        const difference_type s) const noexcept {
+      return iterator(base_, offset_ - s);
+    }
+
+    constexpr iterator &operator++() noexcept {
+      ++offset_;
+      return *this;
+    }
+
+    constexpr iterator &operator--() noexcept {
+      --offset_;
+      return *this;
+    }
+
+    constexpr iterator operator++(int) noexcept {
+      const auto copy = *this;
+      ++offset_;
+      return copy;
+    }
+
+    constexpr iterator operator--(int) noexcept {
+      const auto copy = *this;
+      --offset_;
+      return copy;
+    }
+
+    constexpr bool operator==(
+        const iterator &cmp) const noexcept {
+      return offset_ == cmp.offset_;
+    }
+
+    constexpr bool operator!=(
+        const iterator &cmp) const noexcept {
+      return offset_ != cmp.offset_;
+    }
+
+    constexpr bool operator<(
+        const iterator &cmp) const noexcept {
+      return offset_ < cmp.offset_;
+    }
+
+    constexpr bool operator<=(
+        const iterator &cmp) const noexcept {
+      return offset_ <= cmp.offset_;
+    }
+
+    constexpr bool operator>(
+        const iterator &cmp) const noexcept {
+      return offset_ > cmp.offset_;
+    }
+
+    constexpr bool operator>=(
+        const iterator &cmp) const noexcept {
+      return offset_ >= cmp.offset_;
+    }
+
+   protected:
+    iterator_ base_;
+    offset_iterator_ offset_;
+  };
+
+  // [first, last) are the offsets, so there are
+  // last - first - 1 segments
+  constexpr Segments(const iterator_ &base,
+                     const offset_iterator_ &first,
+                     const offset_iterator_ &last) noexcept
+      : base_(base), first_(first),
+        last_(first == last ? last : last - 1) {}
+
+  constexpr iterator begin() const noexcept {
+    return iterator(base_, first_);
+  }
+  constexpr iterator end() const noexcept {
+    return iterator(base_, last_);
+  }
+
+  constexpr size_type size() const noexcept {
+    return static_cast<size_type>(last_ - first_);
+  }
+  constexpr bool empty() const noexcept {
+    return first_ == last_;
+  }
+
+  constexpr reference operator[](
+      const difference_type i) const noexcept {
+    return begin()[i];
+  }
+
+  // The rows of all of the segments
+  constexpr Slice<iterator_> rows() const noexcept {
+    if(empty()) {
+      return Slice<iterator_>(base_, base_);
+    }
+    return Slice<iterator_>(
+        base_ + static_cast<difference_type>(*first_),
+        base_ + static_cast<difference_type>(*last_));
+  }
+
+ protected:
+  iterator_ base_;
+  offset_iterator_ first_;
+  offset_iterator_ last_;
+};
+
+// offsets is a container of integral row numbers of z, which
+// must outlive the view
+template <typename zip_, typename offsets_>
+constexpr auto segments(const offsets_ &offsets,
+                        const zip_ &z) noexcept {
+  return Segments<typename zip_::iterator,
+                  typename offsets_::const_iterator>(
+      z.begin(), std::cbegin(offsets), std::cend(offsets));
+}
+
+// Synchronized mutation of the containers of a Zip, for
+// containers such as std::vector with reserve, resize,
+// insert and erase. Capacity is decided once for all of the
+// columns, so they grow together rather than each
+// reallocating separately, and batches of rows are moved
+// column by column
+// auto cols = columns(make_zip(pos, vel));
+// cols.reserve(n);
+// cols.push_back({p, v});
+// cols.erase(first, last);
+// As with Zip, the containers must outlive this object
+// If copying or moving a value into a column throws, the
+// columns which had grown are truncated back to their
+// previous size before the exception propagates, so the
+// columns always have equal lengths. Values already moved
+// from an rvalue row are not restored
+template <typename iterator_tag_, typename... containers_>
+class Columns {
+ public:
+  using zip_type = Zip<iterator_tag_, containers_...>;
+  using value_type = typename zip_type::value_type;
+  using size_type = typename zip_type::size_type;
+
+  constexpr Columns() = delete;
+  constexpr Columns(containers_ &&...) = delete;
+
+  constexpr explicit Columns(containers_ &... contents) noexcept
+      : contents_(contents...) {}
+
+  constexpr zip_type zip() const noexcept {
+    return std::apply(
+        [](auto &... c) { return zip_type(c...); }, contents_);
+  }
+
+  size_type size() const noexcept {
+    return std::get<0>(contents_).size();
+  }
+
+  // The number of rows which can be stored without any of
+  // the containers reallocating
+  size_type capacity() const noexcept {
+    return std::apply(
+        [](const auto &... c) {
+          return std::min({static_cast<size_type>(
+              c.capacity())...});
+        },
+        contents_);
+  }
+
+  void reserve(const size_type n) {
+    for_each_column([n](auto &c) { c.reserve(n); });
+  }
+
+  void resize(const size_type n) {
+    ensure_capacity(n);
+    grow_columns([n](auto, auto &c) { c.resize(n); });
+  }
+
+  void clear() noexcept {
+    for_each_column([](auto &c) { c.clear(); });
+  }
+
+  void push_back(const value_type &row) {
+    ensure_capacity(size() + 1);
+    grow_columns([&row](auto I, auto &c) {
+      c.push_back(std::get<I>(row));
+    });
+  }
+
+  void push_back(value_type &&row) {
+    ensure_capacity(size() + 1);
+    grow_columns([&row](auto I, auto &c) {
+      c.push_back(std::move(std::get<I>(row)));
+    });
+  }
+
+  // Appends copies of the rows of src, which may be a Zip or
+  // a Slice with the same column types, inserting each
+  // column as one contiguous range
+  template <typename zip_>
+  void append(const zip_ &src) {
+    ensure_capacity(size() + src.size());
+    const auto first = src.begin().iterators();
+    const auto last = src.end().iterators();
+    grow_columns([&first, &last](auto I, auto &c) {
+      c.insert(c.end(), std::get<I>(first), std::get<I>(last));
+    });
+  }
+
+  // Removes the rows [first, last)
+  void erase(const size_type first, const size_type last) {
+    using difference_type = typename zip_type::difference_type;
+    for_each_column([first, last](auto &c) {
+      c.erase(c.begin() + static_cast<difference_type>(first),
+              c.begin() + static_cast<difference_type>(last));
+    });
+  }
+
+  std::tuple<containers_ &...> contents_;
+
+ protected:
+  template <typename F>
+  void for_each_column(F f) {
+    std::apply([&f](auto &... c) { (f(c), ...); }, contents_);
+  }
+
+  // Calls grow(I, column) for each column in turn, and
+  // truncates the columns to their previous size if one
+  // throws
+  template <typename F>
+  void grow_columns(F grow) {
+    const size_type old_size = size();
+    try {
+      zip_internal_::for_each_index<sizeof...(containers_)>(
+          [&](auto I) { grow(I, std::get<I>(contents_)); });
+    } catch(...) {
+      using difference_type = typename zip_type::difference_type;
+      for_each_column([old_size](auto &c) {
+        if(c.size() > old_size) {
+          c.erase(c.begin() +
+                      static_cast<difference_type>(old_size),
+                  c.end());
+        }
+      });
+      throw;
+    }
+  }
+
+  // Grows every column to the same capacity, at least
+  // doubling it, when required rows would not fit
+  void ensure_capacity(const size_type required) {
+    const size_type current = capacity();
+    if(required > current) {
+      reserve(std::max(required, 2 * current));
+    }
+  }
+};
+
+template <typename iterator_tag_, typename... containers_>
+constexpr auto columns(
+    const Zip<iterator_tag_, containers_...> &z) noexcept {
+  return std::apply(
+      [](auto &... c) {
+        return Columns<iterator_tag_, containers_...>(c...);
+      },
+      z.contents_);
+}
+
 }  // namespace zip
 
 #endif  // _ZIP_HPP_
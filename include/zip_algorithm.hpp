@@ -0,0 +1,1518 @@
+#ifndef _ZIP_ALGORITHM_HPP_
+#define _ZIP_ALGORITHM_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "zip.hpp"
+
+// Algorithms over zips
+// These accept any range of zip iterators, so a Zip, a
+// Slice of one, or a projection can be passed. The
+// underlying iterators must be random access; rows are
+// reached by indexing each column's iterator directly
+// rather than by advancing zip iterators
+
+namespace zip {
+
+// Execution policies
+// An exception thrown by a user supplied operation under
+// parallel_policy calls std::terminate, as with
+// std::execution::par
+struct sequenced_policy {};
+
+// Runs on num_threads threads, or one per hardware thread
+// when num_threads is 0. Fewer threads are used when there
+// would be less than min_chunk rows per thread
+struct parallel_policy {
+  unsigned num_threads = 0;
+  std::size_t min_chunk = 1 << 14;
+};
+
+// Reductions which give bitwise identical results for any
+// number of threads. Rows are reduced in fixed chunks of
+// chunk_size rows, and the chunk results are combined with
+// a fixed pairwise tree, so that the order of floating point
+// operations depends only on the number of rows. Threads
+// are assigned whole chunks
+// Other algorithms accept it too: those whose results do
+// not depend on the number of threads run in parallel, and
+// those which combine per-thread results, such as scans and
+// group_by, run on a single thread
+struct deterministic_policy {
+  unsigned num_threads = 0;
+  std::size_t chunk_size = 1 << 12;
+};
+
+inline constexpr sequenced_policy seq{};
+inline constexpr parallel_policy par{};
+inline constexpr deterministic_policy deterministic{};
+
+template <typename T>
+struct is_execution_policy : std::false_type {};
+template <>
+struct is_execution_policy<sequenced_policy>
+    : std::true_type {};
+template <>
+struct is_execution_policy<parallel_policy> : std::true_type {};
+template <>
+struct is_execution_policy<deterministic_policy>
+    : std::true_type {};
+
+template <typename T>
+inline constexpr bool is_execution_policy_v =
+    is_execution_policy<std::decay_t<T>>::value;
+
+// Applies op to the corresponding elements of two tuples,
+// so that for example elementwise<std::plus<>> sums several
+// columns at once
+template <typename op_>
+struct elementwise {
+  op_ op;
+
+  template <typename lhs_, typename rhs_>
+  constexpr auto operator()(const lhs_ &lhs,
+                            const rhs_ &rhs) const {
+    return impl(
+        lhs, rhs,
+        std::make_index_sequence<std::tuple_size_v<lhs_>>{});
+  }
+
+ private:
+  template <typename lhs_, typename rhs_, std::size_t... Is>
+  constexpr auto impl(const lhs_ &lhs, const rhs_ &rhs,
+                      std::index_sequence<Is...>) const {
+    return std::make_tuple(
+        op(std::get<Is>(lhs), std::get<Is>(rhs))...);
+  }
+};
+
+}  // namespace zip
+
+namespace zip_internal_ {
+
+constexpr std::size_t cache_line_size = 64;
+
+// Keeps a value on its own cache line, so that partial
+// results written by different threads do not false share
+template <typename T>
+struct alignas(cache_line_size) padded {
+  T value;
+};
+
+// Whether dereferencing iterator_ gives an lvalue reference
+// to the value rather than a proxy, so that the value's
+// address may be taken
+template <typename iterator_>
+constexpr bool has_lvalue_references_v =
+    std::is_lvalue_reference_v<
+        typename std::iterator_traits<iterator_>::reference>;
+
+// Random access to the rows of a range of zip iterators
+template <typename iterator_>
+class rows {
+ public:
+  using iterator_tuple = typename iterator_::iterator_tuple;
+  using value_type = typename iterator_::value_type;
+  using reference = typename iterator_::reference;
+
+  explicit rows(const iterator_ &first) noexcept
+      : iters_(first.iterators()) {}
+
+  reference operator[](const std::ptrdiff_t i) const noexcept {
+    return index_tuple<reference>(iters_, i);
+  }
+
+  template <std::size_t column_>
+  decltype(auto) column(const std::ptrdiff_t i) const noexcept {
+    return std::get<column_>(iters_)[i];
+  }
+
+  // Moves row i out of the columns
+  value_type move_row(const std::ptrdiff_t i) const {
+    return std::apply(
+        [i](const auto &... col) {
+          return value_type(std::move(col[i])...);
+        },
+        iters_);
+  }
+
+  const iterator_tuple &iterators() const noexcept {
+    return iters_;
+  }
+
+ private:
+  iterator_tuple iters_;
+};
+
+template <typename zip_>
+rows<typename zip_::iterator> make_rows(const zip_ &z) {
+  return rows<typename zip_::iterator>(z.begin());
+}
+
+template <typename iterator_tuple_>
+struct lvalue_columns;
+template <typename... iterators_>
+struct lvalue_columns<std::tuple<iterators_...>>
+    : std::bool_constant<(
+          has_lvalue_references_v<iterators_> && ...)> {};
+
+// Whether threads may write disjoint rows of rows_ at once,
+// which they may not through proxies, such as Bitmask's,
+// which pack several rows into a word
+template <typename rows_>
+constexpr bool has_lvalue_columns_v =
+    lvalue_columns<typename rows_::iterator_tuple>::value;
+
+inline unsigned thread_count(const zip::sequenced_policy &,
+                             const std::size_t) noexcept {
+  return 1;
+}
+
+inline unsigned thread_count(
+    const zip::parallel_policy &policy,
+    const std::size_t n) noexcept {
+  std::size_t threads = policy.num_threads;
+  if(threads == 0) {
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  const std::size_t min_chunk =
+      std::max(policy.min_chunk, std::size_t(1));
+  threads = std::min(threads, n / min_chunk);
+  return static_cast<unsigned>(std::max(threads, std::size_t(1)));
+}
+
+// Algorithms whose results do not depend on how the rows
+// are divided between the threads, such as compact and
+// scatter, run deterministic_policy in parallel, with at
+// least chunk_size rows per thread
+inline unsigned thread_count(
+    const zip::deterministic_policy &policy,
+    const std::size_t n) noexcept {
+  return thread_count(
+      zip::parallel_policy{
+          policy.num_threads,
+          std::max(policy.chunk_size, std::size_t(1))},
+      n);
+}
+
+// The number of threads for algorithms which combine the
+// partial results of each thread with a user supplied
+// operation, such as a floating point sum, so that their
+// results depend on the number of threads. These run on a
+// single thread under deterministic_policy
+template <typename policy_>
+unsigned combining_thread_count(const policy_ &policy,
+                                const std::size_t n) noexcept {
+  if constexpr(std::is_same_v<policy_,
+                              zip::deterministic_policy>) {
+    return 1;
+  } else {
+    return thread_count(policy, n);
+  }
+}
+
+// The first row of the chunk'th of num_chunks nearly equal
+// contiguous chunks of [0, n)
+constexpr std::ptrdiff_t chunk_begin(
+    const std::size_t n, const std::size_t num_chunks,
+    const std::size_t chunk) noexcept {
+  return static_cast<std::ptrdiff_t>(
+      n / num_chunks * chunk + std::min(chunk, n % num_chunks));
+}
+
+// Calls f(chunk, first, last) for num_chunks contiguous
+// chunks of [0, n), each on its own thread. The calling
+// thread runs the first chunk
+template <typename F>
+void parallel_chunks(const std::size_t n,
+                     const unsigned num_chunks, F &&f) {
+  if(num_chunks <= 1) {
+    f(0u, std::ptrdiff_t(0), static_cast<std::ptrdiff_t>(n));
+    return;
+  }
+  std::vector<std::thread> workers;
+  workers.reserve(num_chunks - 1);
+  for(unsigned c = 1; c < num_chunks; c++) {
+    workers.emplace_back([&f, n, num_chunks, c]() {
+      f(c, chunk_begin(n, num_chunks, c),
+        chunk_begin(n, num_chunks, c + 1));
+    });
+  }
+  f(0u, std::ptrdiff_t(0), chunk_begin(n, num_chunks, 1));
+  for(auto &w : workers) {
+    w.join();
+  }
+}
+
+// Number of independent accumulators used when reducing a
+// contiguous range; breaking the dependency chain on a
+// single accumulator lets the compiler keep them in SIMD
+// lanes. Must be a power of two
+constexpr std::size_t reduce_lanes = 8;
+
+template <typename T, typename rows_, typename reduce_op_,
+          typename transform_op_, std::size_t... lanes_>
+T reduce_lanes_impl(const rows_ &r, const std::ptrdiff_t first,
+                    const std::ptrdiff_t last,
+                    reduce_op_ &reduce_op,
+                    transform_op_ &transform_op,
+                    std::index_sequence<lanes_...>) {
+  constexpr std::ptrdiff_t width = sizeof...(lanes_);
+  std::array<T, width> acc{
+      {T(transform_op(r[first + lanes_]))...}};
+  std::ptrdiff_t i = first + width;
+  for(; i + width <= last; i += width) {
+    ((acc[lanes_] = reduce_op(std::move(acc[lanes_]),
+                              transform_op(r[i + lanes_]))),
+     ...);
+  }
+  for(; i < last; i++) {
+    acc[0] = reduce_op(std::move(acc[0]), transform_op(r[i]));
+  }
+  for(std::ptrdiff_t w = width / 2; w > 0; w /= 2) {
+    for(std::ptrdiff_t l = 0; l < w; l++) {
+      acc[l] = reduce_op(std::move(acc[l]), acc[l + w]);
+    }
+  }
+  return acc[0];
+}
+
+// Reduces the transformed rows [first, last), which must be
+// non-empty, without an initial value
+template <typename T, typename rows_, typename reduce_op_,
+          typename transform_op_>
+T reduce_rows(const rows_ &r, const std::ptrdiff_t first,
+              const std::ptrdiff_t last, reduce_op_ &reduce_op,
+              transform_op_ &transform_op) {
+  if(last - first <
+     static_cast<std::ptrdiff_t>(reduce_lanes)) {
+    T acc(transform_op(r[first]));
+    for(std::ptrdiff_t i = first + 1; i < last; i++) {
+      acc = reduce_op(std::move(acc), transform_op(r[i]));
+    }
+    return acc;
+  }
+  return reduce_lanes_impl<T>(
+      r, first, last, reduce_op, transform_op,
+      std::make_index_sequence<reduce_lanes>{});
+}
+
+template <typename T, typename rows_, typename reduce_op_,
+          typename transform_op_, typename policy_>
+T transform_reduce_rows(const rows_ &r, const std::size_t n,
+                        T init, reduce_op_ &reduce_op,
+                        transform_op_ &transform_op,
+                        const policy_ &policy) {
+  const unsigned num_threads = thread_count(policy, n);
+  std::vector<padded<std::optional<T>>> partial(num_threads);
+  parallel_chunks(n, num_threads,
+                  [&](const unsigned t, const std::ptrdiff_t first,
+                      const std::ptrdiff_t last) {
+                    partial[t].value.emplace(reduce_rows<T>(
+                        r, first, last, reduce_op, transform_op));
+                  });
+  for(auto &p : partial) {
+    init = reduce_op(std::move(init), std::move(*p.value));
+  }
+  return init;
+}
+
+template <typename T, typename rows_, typename reduce_op_,
+          typename transform_op_>
+T transform_reduce_rows(const rows_ &r, const std::size_t n,
+                        T init, reduce_op_ &reduce_op,
+                        transform_op_ &transform_op,
+                        const zip::deterministic_policy &policy) {
+  const std::size_t chunk_size =
+      std::max(policy.chunk_size, std::size_t(1));
+  const std::size_t num_chunks =
+      (n + chunk_size - 1) / chunk_size;
+  std::vector<padded<std::optional<T>>> partial(num_chunks);
+  const unsigned num_threads = thread_count(
+      zip::parallel_policy{policy.num_threads, 1}, num_chunks);
+  parallel_chunks(
+      num_chunks, num_threads,
+      [&](const unsigned, const std::ptrdiff_t first_chunk,
+          const std::ptrdiff_t last_chunk) {
+        for(std::ptrdiff_t c = first_chunk; c < last_chunk;
+            c++) {
+          const auto size =
+              static_cast<std::ptrdiff_t>(chunk_size);
+          const std::ptrdiff_t first = c * size;
+          const std::ptrdiff_t last = std::min(
+              first + size, static_cast<std::ptrdiff_t>(n));
+          partial[c].value.emplace(reduce_rows<T>(
+              r, first, last, reduce_op, transform_op));
+        }
+      });
+  // The tree only depends on the number of chunks
+  for(std::size_t stride = 1; stride < num_chunks;
+      stride *= 2) {
+    for(std::size_t c = 0; c + stride < num_chunks;
+        c += 2 * stride) {
+      partial[c].value.emplace(
+          reduce_op(std::move(*partial[c].value),
+                    std::move(*partial[c + stride].value)));
+    }
+  }
+  return reduce_op(std::move(init),
+                   std::move(*partial[0].value));
+}
+
+// Folds rows [first, last) of r from left to right, which
+// must be non-empty
+template <typename T, typename rows_, typename op_>
+T fold_rows(const rows_ &r, const std::ptrdiff_t first,
+            const std::ptrdiff_t last, op_ &op) {
+  using value_type = typename rows_::value_type;
+  T acc(value_type(r[first]));
+  for(std::ptrdiff_t i = first + 1; i < last; i++) {
+    acc = op(std::move(acc), value_type(r[i]));
+  }
+  return acc;
+}
+
+// Writes the scan of rows [first, last) of in, continuing
+// from carry, to out and returns the new carry. The row is
+// read before the output is written, so in and out may be
+// the same range
+template <bool exclusive_, typename T, typename in_rows_,
+          typename out_rows_, typename op_>
+T scan_rows(const in_rows_ &in, const out_rows_ &out,
+            const std::ptrdiff_t first,
+            const std::ptrdiff_t last, T carry, op_ &op) {
+  using value_type = typename in_rows_::value_type;
+  for(std::ptrdiff_t i = first; i < last; i++) {
+    T next = op(carry, value_type(in[i]));
+    if constexpr(exclusive_) {
+      out[i] = std::move(carry);
+    } else {
+      out[i] = next;
+    }
+    carry = std::move(next);
+  }
+  return carry;
+}
+
+// Two pass scan: each thread first folds its chunk, the
+// chunk totals are scanned serially to give the carry into
+// each chunk, and then each thread scans its chunk again
+// from its carry. Returns the total over all of the rows
+// and init, which must be present for exclusive scans
+template <bool exclusive_, typename T, typename in_rows_,
+          typename out_rows_, typename op_, typename policy_>
+std::optional<T> scan(const in_rows_ &in,
+                      const out_rows_ &out,
+                      const std::size_t n,
+                      std::optional<T> init, op_ &op,
+                      const policy_ &policy) {
+  if(n == 0) {
+    return init;
+  }
+  const unsigned num_threads =
+      has_lvalue_columns_v<out_rows_>
+          ? combining_thread_count(policy, n)
+          : 1;
+  // carry[t] is the total of init and the chunks before t
+  std::vector<padded<std::optional<T>>> carry(num_threads);
+  carry[0].value = std::move(init);
+  if(num_threads > 1) {
+    std::vector<padded<std::optional<T>>> chunk_total(
+        num_threads);
+    parallel_chunks(n, num_threads,
+                    [&](const unsigned t,
+                        const std::ptrdiff_t first,
+                        const std::ptrdiff_t last) {
+                      chunk_total[t].value.emplace(
+                          fold_rows<T>(in, first, last, op));
+                    });
+    for(unsigned t = 1; t < num_threads; t++) {
+      if(carry[t - 1].value) {
+        carry[t].value.emplace(
+            op(*carry[t - 1].value,
+               std::move(*chunk_total[t - 1].value)));
+      } else {
+        carry[t].value = std::move(chunk_total[t - 1].value);
+      }
+    }
+  }
+  std::optional<T> total;
+  parallel_chunks(
+      n, num_threads,
+      [&](const unsigned t, std::ptrdiff_t first,
+          const std::ptrdiff_t last) {
+        std::optional<T> c = carry[t].value;
+        if(!c) {
+          // Only an inclusive scan without init reaches this,
+          // in the first chunk
+          c.emplace(typename in_rows_::value_type(in[first]));
+          out[first] = *c;
+          first++;
+        }
+        T chunk_carry = scan_rows<exclusive_>(
+            in, out, first, last, std::move(*c), op);
+        if(t == num_threads - 1) {
+          total.emplace(std::move(chunk_carry));
+        }
+      });
+  return total;
+}
+
+// Moves the rows of a column whose mask is set towards the
+// front, preserving their order, and returns the number of
+// rows kept. first must be the first row whose mask is not
+// set, so that the destination is always before the source
+// Trivially copyable columns are compacted without
+// branching, by always copying and advancing the
+// destination by the mask
+template <typename iterator_>
+std::ptrdiff_t compact_column(const iterator_ &col,
+                              const unsigned char *mask,
+                              const std::ptrdiff_t first,
+                              const std::ptrdiff_t n) {
+  using value_type =
+      typename std::iterator_traits<iterator_>::value_type;
+  std::ptrdiff_t dest = first;
+  if constexpr(std::is_trivially_copyable_v<value_type>) {
+    for(std::ptrdiff_t i = first; i < n; i++) {
+      col[dest] = col[i];
+      dest += mask[i];
+    }
+  } else {
+    for(std::ptrdiff_t i = first + 1; i < n; i++) {
+      if(mask[i]) {
+        col[dest] = std::move(col[i]);
+        dest++;
+      }
+    }
+  }
+  return dest;
+}
+
+// Compacts every column of the rows r by the keep mask,
+// with the columns divided between the threads
+template <typename rows_, typename policy_>
+std::size_t compact_columns(const rows_ &r,
+                            const unsigned char *mask,
+                            const std::size_t n,
+                            const policy_ &policy) {
+  constexpr std::size_t num_columns =
+      std::tuple_size_v<typename rows_::iterator_tuple>;
+  const auto first = static_cast<std::ptrdiff_t>(
+      std::find(mask, mask + n, 0) - mask);
+  if(first == static_cast<std::ptrdiff_t>(n)) {
+    return n;
+  }
+  std::vector<std::ptrdiff_t> kept(num_columns);
+  const unsigned num_threads = static_cast<unsigned>(
+      std::min(std::size_t(thread_count(policy, n)),
+               num_columns));
+  parallel_chunks(
+      num_columns, num_threads,
+      [&](const unsigned, const std::ptrdiff_t first_column,
+          const std::ptrdiff_t last_column) {
+        for(std::ptrdiff_t c = first_column; c < last_column;
+            c++) {
+          visit_index<num_columns>(
+              c, [&](auto column) {
+                kept[c] = compact_column(
+                    std::get<column>(r.iterators()), mask,
+                    first, static_cast<std::ptrdiff_t>(n));
+              });
+        }
+      });
+  return static_cast<std::size_t>(kept[0]);
+}
+
+// Binary search over the first n elements of one column for
+// the first element e which does not satisfy less(e); the
+// loop has a fixed trip count for a given n and no
+// unpredictable branches
+template <typename iterator_, typename less_>
+std::ptrdiff_t partition_point(const iterator_ &col,
+                               std::ptrdiff_t n, less_ &&less) {
+  std::ptrdiff_t first = 0;
+  while(n > 1) {
+    const std::ptrdiff_t half = n / 2;
+    first = less(col[first + half - 1]) ? first + half : first;
+    n -= half;
+  }
+  return first + (n == 1 && less(col[first]) ? 1 : 0);
+}
+
+// A run of consecutive rows of the output of a merge which
+// come from the same input
+struct merge_run {
+  bool second;
+  std::ptrdiff_t first;
+  std::ptrdiff_t length;
+};
+
+// The runs of a stable merge of the sorted rows of a and b
+// Rows of b are only taken before equivalent rows of a when
+// comp says they are strictly less
+template <typename rows_a_, typename rows_b_,
+          typename compare_>
+std::vector<merge_run> merge_runs(const rows_a_ &a,
+                                  const std::ptrdiff_t n_a,
+                                  const rows_b_ &b,
+                                  const std::ptrdiff_t n_b,
+                                  compare_ &comp) {
+  std::vector<merge_run> runs;
+  std::ptrdiff_t i = 0, j = 0;
+  while(i < n_a && j < n_b) {
+    if(comp(b[j], a[i])) {
+      const std::ptrdiff_t start = j;
+      do {
+        j++;
+      } while(j < n_b && comp(b[j], a[i]));
+      runs.push_back({true, start, j - start});
+    } else {
+      const std::ptrdiff_t start = i;
+      do {
+        i++;
+      } while(i < n_a && !comp(b[j], a[i]));
+      runs.push_back({false, start, i - start});
+    }
+  }
+  if(i < n_a) {
+    runs.push_back({false, i, n_a - i});
+  }
+  if(j < n_b) {
+    runs.push_back({true, j, n_b - j});
+  }
+  return runs;
+}
+
+// Builds a mask from keep(i) for each row, which must only
+// read the rows, and then compacts the columns by it
+template <typename rows_, typename keep_, typename policy_>
+std::size_t compact_rows(const rows_ &r, const std::size_t n,
+                         keep_ &&keep, const policy_ &policy) {
+  std::vector<unsigned char> mask(n);
+  parallel_chunks(n, thread_count(policy, n),
+                  [&](const unsigned, const std::ptrdiff_t first,
+                      const std::ptrdiff_t last) {
+                    for(std::ptrdiff_t i = first; i < last; i++) {
+                      mask[i] = keep(i);
+                    }
+                  });
+  return compact_columns(r, mask.data(), n, policy);
+}
+
+}  // namespace zip_internal_
+
+namespace zip {
+
+// Generalized sum of transform_op(row) over the rows of z,
+// combined with init using reduce_op. As with
+// std::transform_reduce, reduce_op must be associative and
+// commutative, since rows are accumulated in SIMD lanes and
+// per-thread partial results in an unspecified order.
+// Use deterministic_policy for results which do not depend
+// on the number of threads
+// transform_op is called with the tuple of references to
+// the row, and its result must be convertible to T
+//
+// double dot = transform_reduce(
+//     make_zip(x, y), 0.0, std::plus<>(),
+//     [](const auto &row) {
+//       auto [x_i, y_i] = row;
+//       return x_i * y_i;
+//     },
+//     par);
+template <typename zip_, typename T, typename reduce_op_,
+          typename transform_op_,
+          typename policy_ = sequenced_policy>
+T transform_reduce(const zip_ &z, T init,
+                   reduce_op_ reduce_op,
+                   transform_op_ transform_op,
+                   const policy_ &policy = {}) {
+  const std::size_t n = z.size();
+  if(n == 0) {
+    return init;
+  }
+  return zip_internal_::transform_reduce_rows(
+      zip_internal_::make_rows(z), n, std::move(init),
+      reduce_op, transform_op, policy);
+}
+
+// Generalized sum of the rows of z, as value_type tuples
+// auto [sum_x, sum_y] = reduce(
+//     make_zip(x, y), std::tuple<double, double>{0.0, 0.0},
+//     elementwise<std::plus<>>(), par);
+template <typename zip_, typename T, typename reduce_op_,
+          typename policy_ = sequenced_policy>
+T reduce(const zip_ &z, T init, reduce_op_ reduce_op,
+         const policy_ &policy = {}) {
+  using value_type = typename zip_::value_type;
+  return transform_reduce(
+      z, std::move(init), std::move(reduce_op),
+      [](const auto &row) { return value_type(row); }, policy);
+}
+
+// Prefix sums over the rows of in, written to the rows of
+// out, which must be at least as long and may be in itself.
+// The state is a tuple, so several columns can be scanned
+// in one pass over the data:
+// inclusive_scan(make_zip(a, b), make_zip(sum_a, sum_b),
+//                elementwise<std::plus<>>(), par);
+// op is called as op(T, T) and op(T, value_type), and must
+// be associative. Under parallel_policy each thread folds
+// its chunk, and then rescans it from the total of the
+// preceding chunks. An out with a column of proxies, such as
+// a Bitmask, is scanned by one thread
+// Both scans return the total over all of the rows; an
+// inclusive scan without init over an empty range returns
+// value_type{}
+template <typename in_zip_, typename out_zip_, typename op_,
+          typename policy_ = sequenced_policy,
+          typename = std::enable_if_t<
+              is_execution_policy_v<policy_>>>
+typename in_zip_::value_type inclusive_scan(
+    const in_zip_ &in, const out_zip_ &out, op_ op,
+    const policy_ &policy = {}) {
+  using value_type = typename in_zip_::value_type;
+  const auto total = zip_internal_::scan<false, value_type>(
+      zip_internal_::make_rows(in),
+      zip_internal_::make_rows(out), in.size(),
+      std::optional<value_type>(), op, policy);
+  return total ? *total : value_type{};
+}
+
+template <typename in_zip_, typename out_zip_, typename op_,
+          typename T, typename policy_ = sequenced_policy,
+          typename = std::enable_if_t<
+              !is_execution_policy_v<T> &&
+              is_execution_policy_v<policy_>>>
+T inclusive_scan(const in_zip_ &in, const out_zip_ &out,
+                 op_ op, T init,
+                 const policy_ &policy = {}) {
+  return *zip_internal_::scan<false, T>(
+      zip_internal_::make_rows(in),
+      zip_internal_::make_rows(out), in.size(),
+      std::optional<T>(std::move(init)), op, policy);
+}
+
+// Row i of out is set to init combined with the rows before
+// row i of in
+// auto [num_entries] = exclusive_scan(
+//     make_zip(cell_counts), make_zip(cell_offsets),
+//     std::tuple<int>{0}, elementwise<std::plus<>>(), par);
+template <typename in_zip_, typename out_zip_, typename T,
+          typename op_, typename policy_ = sequenced_policy>
+T exclusive_scan(const in_zip_ &in, const out_zip_ &out,
+                 T init, op_ op, const policy_ &policy = {}) {
+  return *zip_internal_::scan<true, T>(
+      zip_internal_::make_rows(in),
+      zip_internal_::make_rows(out), in.size(),
+      std::optional<T>(std::move(init)), op, policy);
+}
+
+// Stream compaction, the equivalent of std::remove_if over
+// the rows of z. pred is called once per row with the tuple
+// of references to the row, to build a mask of the rows to
+// keep; each column is then compacted on its own with a
+// tight loop, rather than moving whole rows through the
+// iterator's tuple of references. Returns the new number of
+// rows; the rows after it are left in a valid but
+// unspecified state, and the containers are not resized
+// auto n = compact(make_zip(pos, vel, id),
+//                  [](const auto &row) {
+//                    return std::get<2>(row) < 0;
+//                  },
+//                  par);
+// pos.resize(n); vel.resize(n); id.resize(n);
+// Under parallel_policy the mask is built in parallel, and
+// the columns are compacted concurrently
+template <typename zip_, typename pred_,
+          typename policy_ = sequenced_policy>
+typename zip_::size_type compact(const zip_ &z, pred_ pred,
+                                 const policy_ &policy = {}) {
+  const auto r = zip_internal_::make_rows(z);
+  return static_cast<typename zip_::size_type>(
+      zip_internal_::compact_rows(
+          r, z.size(),
+          [&](const std::ptrdiff_t i) { return !pred(r[i]); },
+          policy));
+}
+
+// Removes consecutive duplicate rows of z, keeping the first
+// of each run, as std::unique does, with the same column by
+// column compaction as compact. eq is called with the tuples
+// of references to adjacent rows, and by default compares
+// every column. Returns the new number of rows
+// auto n = unique(make_zip(contact_i, contact_j));
+template <typename zip_, typename equal_ = std::equal_to<>,
+          typename policy_ = sequenced_policy>
+typename zip_::size_type unique(const zip_ &z, equal_ eq = {},
+                                const policy_ &policy = {}) {
+  const auto r = zip_internal_::make_rows(z);
+  return static_cast<typename zip_::size_type>(
+      zip_internal_::compact_rows(
+          r, z.size(),
+          [&](const std::ptrdiff_t i) {
+            return i == 0 || !eq(r[i - 1], r[i]);
+          },
+          policy));
+}
+
+// Removes the rows of z whose column column_ is equal to
+// that of the row before, only reading that column to find
+// them
+template <std::size_t column_, typename zip_,
+          typename equal_ = std::equal_to<>,
+          typename policy_ = sequenced_policy>
+typename zip_::size_type unique_by(const zip_ &z,
+                                   equal_ eq = {},
+                                   const policy_ &policy = {}) {
+  const auto r = zip_internal_::make_rows(z);
+  const auto &col = std::get<column_>(r.iterators());
+  return static_cast<typename zip_::size_type>(
+      zip_internal_::compact_rows(
+          r, z.size(),
+          [&](const std::ptrdiff_t i) {
+            return i == 0 || !eq(col[i - 1], col[i]);
+          },
+          policy));
+}
+
+// The inverse of a gather: row i of src is written to row
+// indices[i] of dest, one column at a time. Under
+// parallel_policy the indices must be distinct, and a dest
+// with a column of proxies, such as a Bitmask, is written by
+// one thread
+// Results computed in cell order are returned to the rows
+// of the particles with
+// scatter(make_zip(new_pos, new_vel), cell_order,
+//         make_zip(pos, vel));
+template <typename src_zip_, typename indices_,
+          typename dest_zip_,
+          typename policy_ = sequenced_policy>
+void scatter(const src_zip_ &src, const indices_ &indices,
+             const dest_zip_ &dest, const policy_ &policy = {}) {
+  const std::size_t n = src.size();
+  const auto src_rows = zip_internal_::make_rows(src);
+  const auto dest_rows = zip_internal_::make_rows(dest);
+  const auto index = std::cbegin(indices);
+  const unsigned num_threads =
+      zip_internal_::has_lvalue_columns_v<decltype(dest_rows)>
+          ? zip_internal_::thread_count(policy, n)
+          : 1;
+  zip_internal_::parallel_chunks(
+      n, num_threads,
+      [&](const unsigned, const std::ptrdiff_t first,
+          const std::ptrdiff_t last) {
+        zip_internal_::for_each_index<std::tuple_size_v<
+            typename src_zip_::value_type>>([&](auto I) {
+          const auto &from = std::get<I>(src_rows.iterators());
+          const auto &to = std::get<I>(dest_rows.iterators());
+          for(std::ptrdiff_t i = first; i < last; i++) {
+            to[static_cast<std::ptrdiff_t>(index[i])] = from[i];
+          }
+        });
+      });
+}
+
+// Reorders the rows of z in place so that row i becomes the
+// row previously at perm[i], as when perm is the result of
+// sorting an index column by a key. perm must be a
+// permutation of [0, z.size()) held in a mutable container
+// of integers; it is used to mark the rows already placed by
+// complementing them while the cycles of the permutation are
+// followed, so no memory proportional to the size of z is
+// needed, and is restored before returning. The indices
+// must be less than half of the range of their type
+template <typename zip_, typename perm_>
+void apply_permutation(const zip_ &z, perm_ &perm) {
+  using value_type = typename zip_::value_type;
+  const std::size_t n = z.size();
+  const auto r = zip_internal_::make_rows(z);
+  const auto next = [&perm](const std::size_t i) {
+    return static_cast<std::size_t>(perm[i]);
+  };
+  const auto assign_row = [&r](const std::ptrdiff_t to,
+                             const std::ptrdiff_t from) {
+    zip_internal_::for_each_index<
+        std::tuple_size_v<value_type>>([&](auto I) {
+      const auto &col = std::get<I>(r.iterators());
+      col[to] = std::move(col[from]);
+    });
+  };
+  for(std::size_t start = 0; start < n; start++) {
+    // Complemented entries are larger than any row index
+    if(next(start) >= n || next(start) == start) {
+      continue;
+    }
+    value_type held(r.move_row(start));
+    std::size_t i = start;
+    while(next(i) != start) {
+      const std::size_t from = next(i);
+      assign_row(i, from);
+      perm[i] = ~perm[i];
+      i = from;
+    }
+    r[i] = std::move(held);
+    perm[i] = ~perm[i];
+  }
+  for(std::size_t i = 0; i < n; i++) {
+    if(next(i) >= n) {
+      perm[i] = ~perm[i];
+    }
+  }
+}
+
+// Out of place variant of apply_permutation, which leaves
+// perm untouched. Each column in turn is gathered into a
+// scratch buffer and moved back, in parallel under
+// parallel_policy, so the extra memory needed is one column
+// Columns of bools or of proxies, such as a Bitmask, are
+// permuted by one thread
+template <typename zip_, typename perm_, typename policy_,
+          typename = std::enable_if_t<
+              is_execution_policy_v<policy_>>>
+void apply_permutation(const zip_ &z, const perm_ &perm,
+                       const policy_ &policy) {
+  using value_type = typename zip_::value_type;
+  const std::size_t n = z.size();
+  const auto r = zip_internal_::make_rows(z);
+  const auto index = std::cbegin(perm);
+  const unsigned num_threads =
+      zip_internal_::thread_count(policy, n);
+  zip_internal_::for_each_index<
+      std::tuple_size_v<value_type>>([&](auto I) {
+    using column_type = std::tuple_element_t<I, value_type>;
+    const auto &col = std::get<I>(r.iterators());
+    using column_iterator = std::decay_t<decltype(col)>;
+    std::vector<column_type> scratch(n);
+    // Proxy columns, and the std::vector<bool> scratch of
+    // bool columns, pack several rows into a word
+    const unsigned column_threads =
+        zip_internal_::has_lvalue_references_v<
+            column_iterator> &&
+                !std::is_same_v<column_type, bool>
+            ? num_threads
+            : 1;
+    zip_internal_::parallel_chunks(
+        n, column_threads,
+        [&](const unsigned, const std::ptrdiff_t first,
+            const std::ptrdiff_t last) {
+          for(std::ptrdiff_t i = first; i < last; i++) {
+            scratch[i] = std::move(
+                col[static_cast<std::ptrdiff_t>(index[i])]);
+          }
+        });
+    zip_internal_::parallel_chunks(
+        n, column_threads,
+        [&](const unsigned, const std::ptrdiff_t first,
+            const std::ptrdiff_t last) {
+          std::move(scratch.begin() + first,
+                    scratch.begin() + last, col + first);
+        });
+  });
+}
+
+// Binary searches of a zip sorted by column column_ which
+// only read that column, by indexing it directly, rather
+// than building the tuple of references to every column at
+// each probe as std::lower_bound over the zip's iterators
+// does. The results are iterators of the zip
+// auto row = lower_bound<0>(make_zip(time, x, y), t0);
+template <std::size_t column_, typename zip_, typename key_,
+          typename compare_ = std::less<>>
+typename zip_::iterator lower_bound(const zip_ &z,
+                                    const key_ &key,
+                                    compare_ comp = {}) {
+  const auto col = std::get<column_>(z.begin().iterators());
+  return z.begin() +
+         zip_internal_::partition_point(
+             col, static_cast<std::ptrdiff_t>(z.size()),
+             [&](const auto &e) { return comp(e, key); });
+}
+
+template <std::size_t column_, typename zip_, typename key_,
+          typename compare_ = std::less<>>
+typename zip_::iterator upper_bound(const zip_ &z,
+                                    const key_ &key,
+                                    compare_ comp = {}) {
+  const auto col = std::get<column_>(z.begin().iterators());
+  return z.begin() +
+         zip_internal_::partition_point(
+             col, static_cast<std::ptrdiff_t>(z.size()),
+             [&](const auto &e) { return !comp(key, e); });
+}
+
+// The rows whose column column_ is equivalent to key
+// for(auto [t, x, y] : equal_range<0>(z, t0)) {...}
+template <std::size_t column_, typename zip_, typename key_,
+          typename compare_ = std::less<>>
+Slice<typename zip_::iterator> equal_range(
+    const zip_ &z, const key_ &key, compare_ comp = {}) {
+  const auto first = lower_bound<column_>(z, key, comp);
+  const Slice<typename zip_::iterator> rest(first, z.end());
+  return Slice<typename zip_::iterator>(
+      first, upper_bound<column_>(rest, key, comp));
+}
+
+// Merges the sorted rows of a and b into out, which must
+// have room for both and not overlap them, as std::merge
+// does. comp is called with the tuples of references to two
+// rows, so it should take its arguments as const auto & to
+// avoid copying them into value_types. The runs of rows
+// taken from each input are found first, and then each
+// column is copied one run at a time, rather than copying
+// whole rows through the iterators' tuples of references
+// Returns the end of the merged rows in out
+template <typename zip_a_, typename zip_b_,
+          typename out_zip_, typename compare_ = std::less<>>
+typename out_zip_::iterator merge(const zip_a_ &a,
+                                  const zip_b_ &b,
+                                  const out_zip_ &out,
+                                  compare_ comp = {}) {
+  const auto rows_a = zip_internal_::make_rows(a);
+  const auto rows_b = zip_internal_::make_rows(b);
+  const auto rows_out = zip_internal_::make_rows(out);
+  const auto runs = zip_internal_::merge_runs(
+      rows_a, static_cast<std::ptrdiff_t>(a.size()), rows_b,
+      static_cast<std::ptrdiff_t>(b.size()), comp);
+  zip_internal_::for_each_index<std::tuple_size_v<
+      typename out_zip_::value_type>>([&](auto I) {
+    const auto &col_a = std::get<I>(rows_a.iterators());
+    const auto &col_b = std::get<I>(rows_b.iterators());
+    auto dest = std::get<I>(rows_out.iterators());
+    for(const auto &run : runs) {
+      const auto &src = run.second ? col_b : col_a;
+      dest = std::copy(src + run.first,
+                       src + run.first + run.length, dest);
+    }
+  });
+  return out.begin() +
+         static_cast<std::ptrdiff_t>(a.size() + b.size());
+}
+
+// Merges the sorted rows [0, middle) and [middle, size())
+// of z in place, as std::inplace_merge does. Each column in
+// turn has its first part moved to a buffer, and is then
+// rebuilt from the runs of the merge; the rows of the
+// second part only ever move towards the front, so they
+// are moved in place
+template <typename zip_, typename compare_ = std::less<>>
+void inplace_merge(const zip_ &z,
+                   const typename zip_::size_type middle,
+                   compare_ comp = {}) {
+  using value_type = typename zip_::value_type;
+  const auto n_a = static_cast<std::ptrdiff_t>(middle);
+  const auto n_b = static_cast<std::ptrdiff_t>(z.size()) - n_a;
+  const auto r = zip_internal_::make_rows(z);
+  const auto second = zip_internal_::make_rows(z.drop(middle));
+  const auto runs =
+      zip_internal_::merge_runs(r, n_a, second, n_b, comp);
+  if(runs.size() <= 2 && (runs.empty() || !runs[0].second)) {
+    // Already in order
+    return;
+  }
+  zip_internal_::for_each_index<
+      std::tuple_size_v<value_type>>([&](auto I) {
+    using column_type = std::tuple_element_t<I, value_type>;
+    const auto &col = std::get<I>(r.iterators());
+    std::vector<column_type> buffer(
+        std::make_move_iterator(col),
+        std::make_move_iterator(col + n_a));
+    auto dest = col;
+    for(const auto &run : runs) {
+      if(run.second) {
+        const auto src = col + n_a + run.first;
+        // Avoid self-move assignment of rows already in place
+        dest = dest == src
+                   ? dest + run.length
+                   : std::move(src, src + run.length, dest);
+      } else {
+        dest = std::move(
+            buffer.begin() + run.first,
+            buffer.begin() + run.first + run.length, dest);
+      }
+    }
+  });
+}
+
+// Partitions and selections by a key column
+// These find the new order of the rows from column column_
+// alone, as a mask or a permutation, and then reorder each
+// of the columns in turn, rather than swapping whole rows
+// through the iterators' tuples of references
+
+// Moves the rows whose column column_ satisfies pred before
+// those which don't, and returns an iterator to the first of
+// the latter. The relative order of the rows is not kept
+template <std::size_t column_, typename zip_, typename pred_>
+typename zip_::iterator partition(const zip_ &z, pred_ pred) {
+  using value_type = typename zip_::value_type;
+  const auto n = static_cast<std::ptrdiff_t>(z.size());
+  const auto r = zip_internal_::make_rows(z);
+  const auto &keys = std::get<column_>(r.iterators());
+  std::vector<unsigned char> mask(n);
+  std::ptrdiff_t num_true = 0;
+  for(std::ptrdiff_t i = 0; i < n; i++) {
+    mask[i] = pred(keys[i]) ? 1 : 0;
+    num_true += mask[i];
+  }
+  // Each column repeats the same swaps, found from the mask
+  zip_internal_::for_each_index<
+      std::tuple_size_v<value_type>>([&](auto I) {
+    const auto &col = std::get<I>(r.iterators());
+    std::ptrdiff_t i = 0, j = n - 1;
+    while(true) {
+      while(i < j && mask[i]) {
+        i++;
+      }
+      while(i < j && !mask[j]) {
+        j--;
+      }
+      if(i >= j) {
+        break;
+      }
+      using std::swap;
+      swap(col[i], col[j]);
+      i++;
+      j--;
+    }
+  });
+  return z.begin() + num_true;
+}
+
+// As partition, but keeping the relative order of the rows
+// in both parts. Each column's rows which fail pred are
+// buffered while the others are compacted to the front
+template <std::size_t column_, typename zip_, typename pred_>
+typename zip_::iterator stable_partition(const zip_ &z,
+                                         pred_ pred) {
+  using value_type = typename zip_::value_type;
+  const auto n = static_cast<std::ptrdiff_t>(z.size());
+  const auto r = zip_internal_::make_rows(z);
+  const auto &keys = std::get<column_>(r.iterators());
+  std::vector<unsigned char> mask(n);
+  for(std::ptrdiff_t i = 0; i < n; i++) {
+    mask[i] = pred(keys[i]) ? 1 : 0;
+  }
+  const auto first = static_cast<std::ptrdiff_t>(
+      std::find(mask.begin(), mask.end(), 0) - mask.begin());
+  if(first == n) {
+    return z.end();
+  }
+  std::ptrdiff_t num_true = first;
+  zip_internal_::for_each_index<
+      std::tuple_size_v<value_type>>([&](auto I) {
+    using column_type = std::tuple_element_t<I, value_type>;
+    const auto &col = std::get<I>(r.iterators());
+    std::vector<column_type> rejected;
+    rejected.reserve(n - first);
+    std::ptrdiff_t dest = first;
+    for(std::ptrdiff_t i = first; i < n; i++) {
+      if(mask[i]) {
+        col[dest] = std::move(col[i]);
+        dest++;
+      } else {
+        rejected.push_back(std::move(col[i]));
+      }
+    }
+    std::move(rejected.begin(), rejected.end(), col + dest);
+    num_true = dest;
+  });
+  return z.begin() + num_true;
+}
+
+}  // namespace zip
+
+namespace zip_internal_ {
+
+// The keys of a column paired with their row numbers, so
+// that a selection can run over contiguous keys and then be
+// applied to the zip as a permutation
+template <std::size_t column_, typename rows_>
+auto keyed_rows(const rows_ &r, const std::ptrdiff_t n) {
+  using key_type = std::tuple_element_t<
+      column_, typename rows_::value_type>;
+  const auto &keys = std::get<column_>(r.iterators());
+  std::vector<std::pair<key_type, std::size_t>> keyed;
+  keyed.reserve(n);
+  for(std::ptrdiff_t i = 0; i < n; i++) {
+    keyed.emplace_back(keys[i], static_cast<std::size_t>(i));
+  }
+  return keyed;
+}
+
+template <typename zip_, typename keyed_>
+void apply_keyed_order(const zip_ &z, const keyed_ &keyed) {
+  std::vector<std::size_t> perm(keyed.size());
+  for(std::size_t i = 0; i < keyed.size(); i++) {
+    perm[i] = keyed[i].second;
+  }
+  zip::apply_permutation(z, perm);
+}
+
+}  // namespace zip_internal_
+
+namespace zip {
+
+// Reorders the rows of z so that row nth is the one which
+// would be there if z were sorted by column column_, with no
+// row before it greater and none after it less, as
+// std::nth_element does
+// nth_element<0>(make_zip(x, y, z), median) splits a set of
+// points at the median x for a kd-tree
+template <std::size_t column_, typename zip_,
+          typename compare_ = std::less<>>
+void nth_element(const zip_ &z,
+                 const typename zip_::size_type nth,
+                 compare_ comp = {}) {
+  const auto n = static_cast<std::ptrdiff_t>(z.size());
+  if(static_cast<std::ptrdiff_t>(nth) >= n) {
+    return;
+  }
+  auto keyed = zip_internal_::keyed_rows<column_>(
+      zip_internal_::make_rows(z), n);
+  std::nth_element(
+      keyed.begin(),
+      keyed.begin() + static_cast<std::ptrdiff_t>(nth),
+      keyed.end(), [&comp](const auto &lhs, const auto &rhs) {
+        return comp(lhs.first, rhs.first);
+      });
+  zip_internal_::apply_keyed_order(z, keyed);
+}
+
+// Moves the middle rows of z with the smallest values of
+// column column_ to the front, sorted, as std::partial_sort
+// does. The order of the remaining rows is unspecified
+// partial_sort<1>(make_zip(player, score), 100,
+//                 std::greater<>());
+template <std::size_t column_, typename zip_,
+          typename compare_ = std::less<>>
+void partial_sort(const zip_ &z,
+                  const typename zip_::size_type middle,
+                  compare_ comp = {}) {
+  const auto n = static_cast<std::ptrdiff_t>(z.size());
+  auto keyed = zip_internal_::keyed_rows<column_>(
+      zip_internal_::make_rows(z), n);
+  std::partial_sort(
+      keyed.begin(),
+      keyed.begin() +
+          std::min(static_cast<std::ptrdiff_t>(middle), n),
+      keyed.end(), [&comp](const auto &lhs, const auto &rhs) {
+        return comp(lhs.first, rhs.first);
+      });
+  zip_internal_::apply_keyed_order(z, keyed);
+}
+
+}  // namespace zip
+
+namespace zip_internal_ {
+
+// Rows are tested against the current threshold of top_k a
+// block at a time, with a branch free any-of which the
+// compiler can vectorize; only blocks containing a candidate
+// are examined row by row
+constexpr std::ptrdiff_t top_k_block = 64;
+
+// The best k rows of [first, last) by the key column, as
+// (key, row) pairs in a heap whose front is the worst of them
+// Ties are broken by row number, so the result does not
+// depend on how the rows are divided between threads
+template <typename key_type_, typename column_,
+          typename compare_>
+std::vector<std::pair<key_type_, std::size_t>> top_k_rows(
+    const column_ &keys, const std::ptrdiff_t first,
+    const std::ptrdiff_t last, const std::size_t k,
+    compare_ &comp) {
+  using entry = std::pair<key_type_, std::size_t>;
+  const auto better = [&comp](const entry &lhs,
+                              const entry &rhs) {
+    return comp(lhs.first, rhs.first) ||
+           (!comp(rhs.first, lhs.first) &&
+            lhs.second < rhs.second);
+  };
+  std::vector<entry> heap;
+  heap.reserve(k);
+  const auto offer = [&](const std::ptrdiff_t i) {
+    entry e(keys[i], static_cast<std::size_t>(i));
+    if(heap.size() < k) {
+      heap.push_back(std::move(e));
+      std::push_heap(heap.begin(), heap.end(), better);
+    } else if(better(e, heap.front())) {
+      std::pop_heap(heap.begin(), heap.end(), better);
+      heap.back() = std::move(e);
+      std::push_heap(heap.begin(), heap.end(), better);
+    }
+  };
+  if(k == 0) {
+    return heap;
+  }
+  std::ptrdiff_t i = first;
+  for(; i < last && heap.size() < k; i++) {
+    offer(i);
+  }
+  for(; i < last; i += top_k_block) {
+    const std::ptrdiff_t block_end =
+        std::min(i + top_k_block, last);
+    // Rows equal to the threshold can still win on their row
+    // number, so test with the negated comparison
+    const key_type_ &threshold = heap.front().first;
+    bool any = false;
+    for(std::ptrdiff_t j = i; j < block_end; j++) {
+      any |= !comp(threshold, keys[j]);
+    }
+    if(any) {
+      for(std::ptrdiff_t j = i; j < block_end; j++) {
+        offer(j);
+      }
+    }
+  }
+  return heap;
+}
+
+}  // namespace zip_internal_
+
+namespace zip {
+
+// The row numbers of the k rows of z whose column column_
+// would come first if z were sorted by it with comp, in that
+// order; ties are broken by row number. The rows themselves
+// can be viewed with gather:
+// auto leaders = top_k<1>(make_zip(player, score), 100,
+//                         std::greater<>(), par);
+// for(auto [p, s] : gather(make_zip(player, score), leaders))
+// {...}
+// Each thread keeps a heap of its best k rows, with a
+// threshold test of whole blocks of rows so that rows which
+// can't enter the heap are skipped cheaply, and the heaps are
+// merged at the end
+template <std::size_t column_, typename zip_,
+          typename compare_ = std::less<>,
+          typename policy_ = sequenced_policy>
+std::vector<typename zip_::size_type> top_k(
+    const zip_ &z, const typename zip_::size_type k,
+    compare_ comp = {}, const policy_ &policy = {}) {
+  using key_type =
+      std::tuple_element_t<column_, typename zip_::value_type>;
+  using entry = std::pair<key_type, std::size_t>;
+  const std::size_t n = z.size();
+  const auto r = zip_internal_::make_rows(z);
+  const auto &keys = std::get<column_>(r.iterators());
+  const unsigned num_threads =
+      zip_internal_::thread_count(policy, n);
+  std::vector<std::vector<entry>> partial(num_threads);
+  zip_internal_::parallel_chunks(
+      n, num_threads,
+      [&](const unsigned t, const std::ptrdiff_t first,
+          const std::ptrdiff_t last) {
+        partial[t] = zip_internal_::top_k_rows<key_type>(
+            keys, first, last, k, comp);
+      });
+  std::vector<entry> best = std::move(partial[0]);
+  for(unsigned t = 1; t < num_threads; t++) {
+    best.insert(best.end(),
+                std::make_move_iterator(partial[t].begin()),
+                std::make_move_iterator(partial[t].end()));
+  }
+  const auto better = [&comp](const entry &lhs,
+                              const entry &rhs) {
+    return comp(lhs.first, rhs.first) ||
+           (!comp(rhs.first, lhs.first) &&
+            lhs.second < rhs.second);
+  };
+  const std::size_t num_best = std::min(best.size(), k);
+  std::partial_sort(best.begin(),
+                    best.begin() +
+                        static_cast<std::ptrdiff_t>(num_best),
+                    best.end(), better);
+  std::vector<typename zip_::size_type> rows(num_best);
+  for(std::size_t i = 0; i < num_best; i++) {
+    rows[i] = static_cast<typename zip_::size_type>(
+        best[i].second);
+  }
+  return rows;
+}
+
+}  // namespace zip
+
+namespace zip {
+
+// count equal width bins over [lower, upper) for histogram
+template <typename T>
+struct uniform_bins {
+  T lower;
+  T upper;
+  std::size_t count;
+};
+
+}  // namespace zip
+
+namespace zip_internal_ {
+
+// histogram computes the bins of a block of rows at a time
+// in a branch free, vectorizable loop per column, before
+// incrementing the counts
+constexpr std::ptrdiff_t histogram_block = 256;
+
+// Adds the rows [first, last) to counts, a row major array of
+// the bins of the columns, with one extra entry at the end
+// for rows outside of the bins. Rows add their weight_
+// column's value when weighted_, and 1 otherwise
+template <bool weighted_, std::size_t weight_,
+          std::size_t... columns_, typename rows_,
+          typename count_, typename... bins_>
+void histogram_rows(const rows_ &r, const std::ptrdiff_t first,
+                    const std::ptrdiff_t last,
+                    std::vector<count_> &counts,
+                    const std::tuple<bins_...> &bins) {
+  constexpr std::size_t columns[] = {columns_...};
+  const std::size_t outside = counts.size() - 1;
+  std::array<std::size_t, histogram_block> flat;
+  std::array<unsigned char, histogram_block> inside;
+  for(std::ptrdiff_t i = first; i < last;
+      i += histogram_block) {
+    const std::ptrdiff_t m =
+        std::min(histogram_block, last - i);
+    for(std::ptrdiff_t j = 0; j < m; j++) {
+      flat[j] = 0;
+      inside[j] = 1;
+    }
+    for_each_index<sizeof...(columns_)>([&](auto d) {
+      const auto &col = std::get<columns[d]>(r.iterators());
+      const auto &b = std::get<d>(bins);
+      const double lower = static_cast<double>(b.lower);
+      const double num_bins = static_cast<double>(b.count);
+      const double scale =
+          num_bins / (static_cast<double>(b.upper) - lower);
+      for(std::ptrdiff_t j = 0; j < m; j++) {
+        const double f =
+            (static_cast<double>(col[i + j]) - lower) * scale;
+        const bool in_range = f >= 0.0 && f < num_bins;
+        flat[j] = flat[j] * b.count +
+                  (in_range ? static_cast<std::size_t>(f) : 0);
+        inside[j] &= in_range;
+      }
+    });
+    for(std::ptrdiff_t j = 0; j < m; j++) {
+      const std::size_t bin = inside[j] ? flat[j] : outside;
+      if constexpr(weighted_) {
+        counts[bin] += static_cast<count_>(
+            std::get<weight_>(r.iterators())[i + j]);
+      } else {
+        counts[bin]++;
+      }
+    }
+  }
+}
+
+template <typename count_, bool weighted_,
+          std::size_t weight_, std::size_t... columns_,
+          typename zip_, typename policy_, typename... bins_>
+std::vector<count_> histogram(const zip_ &z,
+                              const policy_ &policy,
+                              const bins_ &... bins) {
+  static_assert(sizeof...(columns_) == sizeof...(bins_),
+                "Each histogram column needs its bins");
+  const std::size_t num_bins = (std::size_t(1) * ... *
+                                bins.count);
+  const std::size_t n = z.size();
+  const auto r = make_rows(z);
+  const auto all_bins = std::make_tuple(bins...);
+  // Weights are summed in floating point
+  const unsigned num_threads =
+      weighted_ ? combining_thread_count(policy, n)
+                : thread_count(policy, n);
+  // Private bins for each thread, merged at the end
+  std::vector<std::vector<count_>> partial(
+      num_threads, std::vector<count_>(num_bins + 1));
+  parallel_chunks(
+      n, num_threads,
+      [&](const unsigned t, const std::ptrdiff_t first,
+          const std::ptrdiff_t last) {
+        histogram_rows<weighted_, weight_, columns_...>(
+            r, first, last, partial[t], all_bins);
+      });
+  std::vector<count_> counts = std::move(partial[0]);
+  for(unsigned t = 1; t < num_threads; t++) {
+    for(std::size_t b = 0; b < num_bins; b++) {
+      counts[b] += partial[t][b];
+    }
+  }
+  counts.pop_back();
+  return counts;
+}
+
+}  // namespace zip_internal_
+
+namespace zip {
+
+// Counts the rows of z in the bins of columns columns_...,
+// one uniform_bins per column. The result is the row major
+// array of the counts, so for two columns with bins a and b
+// the count of bin (i, j) is at i * b.count + j. Rows
+// outside of the bins are not counted
+// auto counts = histogram<0, 1>(make_zip(x, y), par,
+//                               uniform_bins<double>{0, 1, 64},
+//                               uniform_bins<double>{0, 1, 64});
+// With a policy as the second argument, each thread counts
+// its rows into private bins which are summed at the end
+template <std::size_t... columns_, typename zip_,
+          typename policy_, typename... bins_,
+          typename = std::enable_if_t<
+              is_execution_policy_v<policy_>>>
+std::vector<std::size_t> histogram(const zip_ &z,
+                                   const policy_ &policy,
+                                   const bins_ &... bins) {
+  return zip_internal_::histogram<std::size_t, false, 0,
+                                  columns_...>(z, policy,
+                                               bins...);
+}
+
+template <std::size_t... columns_, typename zip_,
+          typename... bins_,
+          typename = std::enable_if_t<
+              (!is_execution_policy_v<bins_> && ...)>>
+std::vector<std::size_t> histogram(const zip_ &z,
+                                   const bins_ &... bins) {
+  return histogram<columns_...>(z, seq, bins...);
+}
+
+// As histogram, with each row adding the value of its
+// weight_ column to its bin rather than 1
+// auto speeds = weighted_histogram<1, 0>(
+//     make_zip(speed, mass), par,
+//     uniform_bins<double>{0.0, 10.0, 100});
+template <std::size_t weight_, std::size_t... columns_,
+          typename zip_, typename policy_, typename... bins_,
+          typename = std::enable_if_t<
+              is_execution_policy_v<policy_>>>
+std::vector<double> weighted_histogram(const zip_ &z,
+                                       const policy_ &policy,
+                                       const bins_ &... bins) {
+  return zip_internal_::histogram<double, true, weight_,
+                                  columns_...>(z, policy,
+                                               bins...);
+}
+
+template <std::size_t weight_, std::size_t... columns_,
+          typename zip_, typename... bins_,
+          typename = std::enable_if_t<
+              (!is_execution_policy_v<bins_> && ...)>>
+std::vector<double> weighted_histogram(const zip_ &z,
+                                       const bins_ &... bins) {
+  return weighted_histogram<weight_, columns_...>(z, seq,
+                                                  bins...);
+}
+
+}  // namespace zip
+
+#endif  // _ZIP_ALGORITHM_HPP_
@@ -0,0 +1,379 @@
+#ifndef _ZIP_BITMASK_HPP_
+#define _ZIP_BITMASK_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include "zip_algorithm.hpp"
+
+namespace zip_internal_ {
+
+using mask_word = std::uint64_t;
+constexpr std::size_t mask_word_bits = 64;
+
+// The index of the lowest set bit of a non-zero word
+inline unsigned count_trailing_zeros(
+    const mask_word w) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_ctzll(w));
+#else
+  unsigned n = 0;
+  for(mask_word b = w; (b & 1) == 0; b >>= 1) {
+    n++;
+  }
+  return n;
+#endif
+}
+
+inline std::size_t popcount(const mask_word w) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<std::size_t>(__builtin_popcountll(w));
+#else
+  std::size_t n = 0;
+  for(mask_word b = w; b != 0; b &= b - 1) {
+    n++;
+  }
+  return n;
+#endif
+}
+
+}  // namespace zip_internal_
+
+namespace zip {
+
+// A container of bits packed 64 to a word, which can be
+// zipped with other columns to flag their rows. Unlike
+// std::vector<bool>, its iterators are random access
+// iterators whose reference is a proxy which can be copied
+// into the tuples of references of a Zip and assigned
+// through
+// Bitmask active(pos.size());
+// for(auto [p, a] : make_zip(pos, active)) {
+//   a = p.x > 0.0;
+// }
+// for_each_set(make_zip(pos, vel), active, f);
+// Bits past size() in the last word are kept clear
+class Bitmask {
+ public:
+  using word_type = zip_internal_::mask_word;
+  using value_type = bool;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using const_reference = bool;
+
+  // Refers to a single bit; assigning to a copy assigns to
+  // the bit
+  class reference {
+   public:
+    constexpr reference(word_type *word,
+                        const word_type bit) noexcept
+        : word_(word), bit_(bit) {}
+    reference(const reference &) = default;
+
+    constexpr operator bool() const noexcept {
+      return (*word_ & bit_) != 0;
+    }
+
+    const reference &operator=(const bool b) const noexcept {
+      if(b) {
+        *word_ |= bit_;
+      } else {
+        *word_ &= ~bit_;
+      }
+      return *this;
+    }
+
+    const reference &operator=(
+        const reference &src) const noexcept {
+      return *this = static_cast<bool>(src);
+    }
+
+    void flip() const noexcept { *word_ ^= bit_; }
+
+    // Exchanges the bits referred to, rather than the proxies,
+    // which the generic std::swap would do by copying them
+    friend void swap(reference a, reference b) noexcept {
+      const bool held = a;
+      a = static_cast<bool>(b);
+      b = held;
+    }
+
+   private:
+    word_type *word_;
+    word_type bit_;
+  };
+
+  using pointer = reference *;
+  using const_pointer = const bool *;
+
+  template <bool const_>
+  class iterator_t {
+   public:
+    using value_type = bool;
+    using reference =
+        std::conditional_t<const_, bool, Bitmask::reference>;
+    using pointer = std::conditional_t<const_, const bool *,
+                                       Bitmask::reference *>;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category =
+        std::random_access_iterator_tag;
+    using word_pointer =
+        std::conditional_t<const_, const word_type *,
+                           word_type *>;
+
+    constexpr iterator_t() noexcept = default;
+    constexpr iterator_t(word_pointer words,
+                         const difference_type i) noexcept
+        : words_(words), i_(i) {}
+    // Mutable iterators convert to const iterators
+    template <bool other_,
+              typename = std::enable_if_t<const_ && !other_>>
+    constexpr iterator_t(
+        const iterator_t<other_> &src) noexcept
+        : words_(src.words_), i_(src.i_) {}
+
+    constexpr reference operator[](
+        const difference_type n) const noexcept {
+      const auto i = static_cast<std::size_t>(i_ + n);
+      const word_type bit =
+          word_type(1) << (i % zip_internal_::mask_word_bits);
+      word_pointer word =
+          words_ + i / zip_internal_::mask_word_bits;
+      if constexpr(const_) {
+        return (*word & bit) != 0;
+      } else {
+        return reference(word, bit);
+      }
+    }
+    constexpr reference operator*() const noexcept {
+      return (*this)[0];
+    }
+
+    constexpr iterator_t &operator+=(
+        const difference_type n) noexcept {
+      i_ += n;
+      return *this;
+    }
+    constexpr iterator_t &operator-=(
+        const difference_type n) noexcept {
+      i_ -= n;
+      return *this;
+    }
+    constexpr iterator_t operator+(
+        const difference_type n) const noexcept {
+      return iterator_t(words_, i_ + n);
+    }
+    constexpr iterator_t operator-(
+        const difference_type n) const noexcept {
+      return iterator_t(words_, i_ - n);
+    }
+    constexpr difference_type operator-(
+        const iterator_t &rhs) const noexcept {
+      return i_ - rhs.i_;
+    }
+    constexpr iterator_t &operator++() noexcept {
+      i_++;
+      return *this;
+    }
+    constexpr iterator_t &operator--() noexcept {
+      i_--;
+      return *this;
+    }
+    constexpr iterator_t operator++(int) noexcept {
+      const auto copy = *this;
+      i_++;
+      return copy;
+    }
+    constexpr iterator_t operator--(int) noexcept {
+      const auto copy = *this;
+      i_--;
+      return copy;
+    }
+
+    constexpr bool operator==(
+        const iterator_t &cmp) const noexcept {
+      return i_ == cmp.i_;
+    }
+    constexpr bool operator!=(
+        const iterator_t &cmp) const noexcept {
+      return i_ != cmp.i_;
+    }
+    constexpr bool operator<(
+        const iterator_t &cmp) const noexcept {
+      return i_ < cmp.i_;
+    }
+    constexpr bool operator<=(
+        const iterator_t &cmp) const noexcept {
+      return i_ <= cmp.i_;
+    }
+    constexpr bool operator>(
+        const iterator_t &cmp) const noexcept {
+      return i_ > cmp.i_;
+    }
+    constexpr bool operator>=(
+        const iterator_t &cmp) const noexcept {
+      return i_ >= cmp.i_;
+    }
+
+   protected:
+    template <bool>
+    friend class iterator_t;
+
+    word_pointer words_ = nullptr;
+    difference_type i_ = 0;
+  };
+
+  using iterator = iterator_t<false>;
+  using const_iterator = iterator_t<true>;
+
+  Bitmask() = default;
+  explicit Bitmask(const size_type n,
+                   const bool value = false)
+      : words_(num_words(n), value ? ~word_type(0) : 0),
+        size_(n) {
+    clear_tail();
+  }
+
+  size_type size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+
+  iterator begin() noexcept {
+    return iterator(words_.data(), 0);
+  }
+  iterator end() noexcept {
+    return iterator(words_.data(),
+                    static_cast<difference_type>(size_));
+  }
+  const_iterator begin() const noexcept { return cbegin(); }
+  const_iterator end() const noexcept { return cend(); }
+  const_iterator cbegin() const noexcept {
+    return const_iterator(words_.data(), 0);
+  }
+  const_iterator cend() const noexcept {
+    return const_iterator(
+        words_.data(), static_cast<difference_type>(size_));
+  }
+
+  reference operator[](const size_type i) noexcept {
+    return begin()[static_cast<difference_type>(i)];
+  }
+  bool operator[](const size_type i) const noexcept {
+    return test(i);
+  }
+
+  bool test(const size_type i) const noexcept {
+    return (words_[i / zip_internal_::mask_word_bits] >>
+            (i % zip_internal_::mask_word_bits)) &
+           1;
+  }
+  void set(const size_type i) noexcept { (*this)[i] = true; }
+  void reset(const size_type i) noexcept {
+    (*this)[i] = false;
+  }
+
+  // The number of set bits
+  size_type count() const noexcept {
+    size_type n = 0;
+    for(const word_type w : words_) {
+      n += zip_internal_::popcount(w);
+    }
+    return n;
+  }
+
+  void resize(const size_type n, const bool value = false) {
+    const size_type old_size = size_;
+    words_.resize(num_words(n), value ? ~word_type(0) : 0);
+    size_ = n;
+    if(value && old_size < n &&
+       old_size % zip_internal_::mask_word_bits != 0) {
+      words_[old_size / zip_internal_::mask_word_bits] |=
+          ~word_type(0)
+          << (old_size % zip_internal_::mask_word_bits);
+    }
+    clear_tail();
+  }
+  void reserve(const size_type n) {
+    words_.reserve(num_words(n));
+  }
+  void push_back(const bool value) {
+    resize(size_ + 1);
+    (*this)[size_ - 1] = value;
+  }
+  void clear() noexcept {
+    words_.clear();
+    size_ = 0;
+  }
+
+  // The packed bits, with row i at bit i % 64 of word i / 64
+  const std::vector<word_type> &words() const noexcept {
+    return words_;
+  }
+
+  // Bitwise combinations of masks of the same size
+  Bitmask &operator&=(const Bitmask &rhs) noexcept {
+    for(size_type w = 0; w < words_.size(); w++) {
+      words_[w] &= rhs.words_[w];
+    }
+    return *this;
+  }
+  Bitmask &operator|=(const Bitmask &rhs) noexcept {
+    for(size_type w = 0; w < words_.size(); w++) {
+      words_[w] |= rhs.words_[w];
+    }
+    return *this;
+  }
+  void flip() noexcept {
+    for(word_type &w : words_) {
+      w = ~w;
+    }
+    clear_tail();
+  }
+
+ protected:
+  static constexpr size_type num_words(const size_type n) {
+    return (n + zip_internal_::mask_word_bits - 1) /
+           zip_internal_::mask_word_bits;
+  }
+
+  void clear_tail() noexcept {
+    if(size_ % zip_internal_::mask_word_bits != 0) {
+      words_.back() &=
+          ~(~word_type(0)
+            << (size_ % zip_internal_::mask_word_bits));
+    }
+  }
+
+  std::vector<word_type> words_;
+  size_type size_ = 0;
+};
+
+// Calls f(row) with the tuple of references to each row i
+// of z with mask[i] set, in order, and returns the number of
+// rows visited. The mask is scanned a word at a time, so
+// runs of clear bits cost one test per 64 rows
+template <typename zip_, typename F>
+typename zip_::size_type for_each_set(const zip_ &z,
+                                      const Bitmask &mask,
+                                      F f) {
+  const auto r = zip_internal_::make_rows(z);
+  const auto &words = mask.words();
+  typename zip_::size_type count = 0;
+  for(std::size_t w = 0; w < words.size(); w++) {
+    const auto first = static_cast<std::ptrdiff_t>(
+        w * zip_internal_::mask_word_bits);
+    for(Bitmask::word_type bits = words[w]; bits != 0;
+        bits &= bits - 1) {
+      f(r[first +
+          zip_internal_::count_trailing_zeros(bits)]);
+      count++;
+    }
+  }
+  return count;
+}
+
+}  // namespace zip
+
+#endif  // _ZIP_BITMASK_HPP_
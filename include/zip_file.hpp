@@ -0,0 +1,487 @@
+#ifndef _ZIP_FILE_HPP_
+#define _ZIP_FILE_HPP_
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "zip.hpp"
+#include "zip_algorithm.hpp"
+
+// Columnar files of zipped rows, for POSIX systems
+// A file starts with a header giving the number of rows and
+// columns, followed by a table of the offset and element
+// size of each column. The header is padded to
+// columns_file_alignment bytes, and each column's values are
+// stored contiguously from an offset which is a multiple of
+// it, so that every column can be mapped and read in place
+// and written with aligned, direct I/O. Values are stored in
+// the byte order of the machine
+
+namespace zip_internal_ {
+
+constexpr char columns_file_magic[8] = {'Z', 'I', 'P', 'C',
+                                        'O', 'L', 'S', '\0'};
+constexpr std::uint32_t columns_file_version = 1;
+constexpr std::uint64_t columns_file_alignment = 4096;
+
+struct columns_file_header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t num_columns;
+  std::uint64_t rows;
+};
+
+struct columns_file_column {
+  std::uint64_t offset;
+  std::uint64_t element_size;
+};
+
+constexpr std::uint64_t align_up(const std::uint64_t n,
+                                 const std::uint64_t a) {
+  return (n + a - 1) / a * a;
+}
+
+// The size of the header and column table of a file of
+// num_columns columns, padded to the alignment
+constexpr std::uint64_t columns_file_header_size(
+    const std::uint64_t num_columns) {
+  return align_up(sizeof(columns_file_header) +
+                      num_columns * sizeof(columns_file_column),
+                  columns_file_alignment);
+}
+
+}  // namespace zip_internal_
+
+namespace zip {
+
+// Expected access patterns of mapped columns, passed to
+// madvise so the kernel can read ahead or not
+enum class access_hint { normal, sequential, random, willneed };
+
+// A read only zip of the columns of a columnar file, whose
+// rows are the file's pages mapped into memory rather than
+// copies, so datasets larger than memory can be zipped and
+// only the pages which are touched are read. The types T...
+// must match the element sizes of the file's columns
+// MappedColumns<double, double, int> particles(
+//     "particles.zip");
+// for(auto [mass, charge, id] : particles.zip()) {...}
+// Zips made by zip() refer to this object, and must not
+// outlive it
+template <typename... T>
+class MappedColumns {
+ public:
+  static_assert((std::is_trivially_copyable_v<T> && ...),
+                "Mapped columns must be trivially copyable");
+
+  using zip_type = Zip<std::random_access_iterator_tag,
+                       const Span<const T>...>;
+  using size_type = std::size_t;
+
+  explicit MappedColumns(
+      const std::string &path,
+      const access_hint hint = access_hint::sequential) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+      throw std::system_error(errno, std::generic_category(),
+                              "Cannot open " + path);
+    }
+    struct stat st;
+    if(::fstat(fd, &st) != 0) {
+      const int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(),
+                              "Cannot stat " + path);
+    }
+    length_ = static_cast<std::size_t>(st.st_size);
+    if(length_ < sizeof(zip_internal_::columns_file_header)) {
+      ::close(fd);
+      throw std::runtime_error(path +
+                               " is not a columnar file");
+    }
+    data_ = ::mmap(nullptr, length_, PROT_READ, MAP_PRIVATE,
+                   fd, 0);
+    const int error = errno;
+    // The mapping keeps the file open
+    ::close(fd);
+    if(data_ == MAP_FAILED) {
+      data_ = nullptr;
+      throw std::system_error(error, std::generic_category(),
+                              "Cannot map " + path);
+    }
+    try {
+      read_header(path);
+    } catch(...) {
+      ::munmap(data_, length_);
+      throw;
+    }
+    advise(hint);
+  }
+
+  MappedColumns(const MappedColumns &) = delete;
+  MappedColumns &operator=(const MappedColumns &) = delete;
+
+  ~MappedColumns() {
+    if(data_ != nullptr) {
+      ::munmap(data_, length_);
+    }
+  }
+
+  size_type size() const noexcept { return rows_; }
+
+  zip_type zip() const noexcept {
+    return std::apply(
+        [](const auto &... columns) {
+          return zip_type(columns...);
+        },
+        columns_);
+  }
+
+  template <std::size_t column_>
+  const auto &column() const noexcept {
+    return std::get<column_>(columns_);
+  }
+
+  // Replaces the hint given to the kernel for the whole file;
+  // willneed starts reading it in the background
+  void advise(const access_hint hint) const noexcept {
+    int advice = MADV_NORMAL;
+    switch(hint) {
+      case access_hint::normal:
+        advice = MADV_NORMAL;
+        break;
+      case access_hint::sequential:
+        advice = MADV_SEQUENTIAL;
+        break;
+      case access_hint::random:
+        advice = MADV_RANDOM;
+        break;
+      case access_hint::willneed:
+        advice = MADV_WILLNEED;
+        break;
+    }
+    // Only a hint, so failures are ignored
+    ::madvise(data_, length_, advice);
+  }
+
+ protected:
+  void read_header(const std::string &path) {
+    const auto *bytes = static_cast<const unsigned char *>(data_);
+    zip_internal_::columns_file_header header;
+    std::memcpy(&header, bytes, sizeof(header));
+    if(std::memcmp(header.magic,
+                   zip_internal_::columns_file_magic,
+                   sizeof(header.magic)) != 0 ||
+       header.version != zip_internal_::columns_file_version) {
+      throw std::runtime_error(path +
+                               " is not a columnar file");
+    }
+    if(header.num_columns != sizeof...(T) ||
+       length_ < zip_internal_::columns_file_header_size(
+                     sizeof...(T))) {
+      throw std::runtime_error(
+          path + " does not have " +
+          std::to_string(sizeof...(T)) + " columns");
+    }
+    rows_ = static_cast<size_type>(header.rows);
+    const auto *table = bytes + sizeof(header);
+    zip_internal_::for_each_index<sizeof...(T)>([&](auto I) {
+      using column_type =
+          std::tuple_element_t<I, std::tuple<T...>>;
+      zip_internal_::columns_file_column c;
+      std::memcpy(&c, table + I * sizeof(c), sizeof(c));
+      if(c.element_size != sizeof(column_type) ||
+         c.offset % alignof(column_type) != 0 ||
+         c.offset > length_ ||
+         (length_ - c.offset) / sizeof(column_type) < rows_) {
+        throw std::runtime_error(
+            path + " column " + std::to_string(I) +
+            " does not match its type");
+      }
+      std::get<I>(columns_) = Span<const column_type>(
+          reinterpret_cast<const column_type *>(bytes +
+                                                c.offset),
+          rows_);
+    });
+  }
+
+  void *data_ = nullptr;
+  std::size_t length_ = 0;
+  size_type rows_ = 0;
+  std::tuple<Span<const T>...> columns_;
+};
+
+// Options for write_columns
+struct write_options {
+  // Bytes staged before each write; rounded up to a
+  // multiple of the file alignment
+  std::size_t buffer_size = std::size_t(1) << 22;
+  // Bypass the page cache with O_DIRECT where it is
+  // supported, which avoids evicting the working set when
+  // writing large checkpoints. Falls back to buffered writes
+  // on file systems which do not support it
+  bool direct = false;
+  // Flush the file to the disk before returning
+  bool sync = false;
+};
+
+}  // namespace zip
+
+namespace zip_internal_ {
+
+// Writes a file through an aligned staging buffer. Only
+// whole multiples of the file alignment are written, from
+// aligned offsets, as O_DIRECT requires; the remainder stays
+// in the buffer until more is added or the stream is padded
+class aligned_file_writer {
+ public:
+  aligned_file_writer(const std::string &path,
+                      const zip::write_options &options)
+      : path_(path),
+        capacity_(static_cast<std::size_t>(align_up(
+            std::max(options.buffer_size, std::size_t(1)),
+            columns_file_alignment))),
+        buffer_(static_cast<unsigned char *>(::operator new(
+                    capacity_,
+                    std::align_val_t(columns_file_alignment))),
+                buffer_deleter()) {
+    constexpr int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    if(options.direct) {
+      fd_ = ::open(path.c_str(), flags | O_DIRECT, 0644);
+      direct_ = fd_ >= 0;
+    }
+#endif
+    if(fd_ < 0) {
+      fd_ = ::open(path.c_str(), flags, 0644);
+    }
+    if(fd_ < 0) {
+      throw std::system_error(errno, std::generic_category(),
+                              "Cannot open " + path);
+    }
+  }
+
+  aligned_file_writer(const aligned_file_writer &) = delete;
+  aligned_file_writer &operator=(
+      const aligned_file_writer &) = delete;
+
+  ~aligned_file_writer() {
+    if(fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  // The offset in the file of the next byte added
+  std::uint64_t position() const noexcept {
+    return written_ + fill_;
+  }
+
+  // Space for at least one more byte, staged after the
+  // previous ones
+  unsigned char *next(std::size_t &available) {
+    if(fill_ == capacity_) {
+      drain();
+    }
+    available = capacity_ - fill_;
+    return buffer_.get() + fill_;
+  }
+  void commit(const std::size_t n) noexcept { fill_ += n; }
+
+  void put(const void *src, std::size_t n) {
+    const auto *bytes = static_cast<const unsigned char *>(src);
+    while(n > 0) {
+      std::size_t available;
+      unsigned char *dest = next(available);
+      const std::size_t k = std::min(n, available);
+      std::memcpy(dest, bytes, k);
+      commit(k);
+      bytes += k;
+      n -= k;
+    }
+  }
+
+  // Adds zeros up to the next multiple of the alignment
+  void pad() {
+    const std::size_t end = static_cast<std::size_t>(
+        align_up(fill_, columns_file_alignment));
+    std::memset(buffer_.get() + fill_, 0, end - fill_);
+    fill_ = end;
+  }
+
+  // Pads and writes everything staged
+  void finish(const bool sync) {
+    pad();
+    drain();
+    if(sync && ::fsync(fd_) != 0) {
+      fail("Cannot sync ");
+    }
+    if(::close(fd_) != 0) {
+      fd_ = -1;
+      fail("Cannot close ");
+    }
+    fd_ = -1;
+  }
+
+ protected:
+  struct buffer_deleter {
+    void operator()(unsigned char *p) const noexcept {
+      ::operator delete(
+          p, std::align_val_t(columns_file_alignment));
+    }
+  };
+
+  [[noreturn]] void fail(const char *what) const {
+    throw std::system_error(errno, std::generic_category(),
+                            what + path_);
+  }
+
+  void disable_direct() {
+#ifdef O_DIRECT
+    const int flags = ::fcntl(fd_, F_GETFL);
+    if(flags < 0 ||
+       ::fcntl(fd_, F_SETFL, flags & ~O_DIRECT) != 0) {
+      fail("Cannot disable direct I/O for ");
+    }
+#endif
+    direct_ = false;
+  }
+
+  // Writes the aligned part of the staged bytes, and moves
+  // the rest to the front of the buffer
+  void drain() {
+    const std::size_t n =
+        fill_ / columns_file_alignment * columns_file_alignment;
+    for(std::size_t done = 0; done < n;) {
+      const ::ssize_t w =
+          ::write(fd_, buffer_.get() + done, n - done);
+      if(w < 0) {
+        if(errno == EINTR) {
+          continue;
+        }
+        fail("Cannot write ");
+      }
+      if(w == 0) {
+        errno = EIO;
+        fail("Cannot write ");
+      }
+      done += static_cast<std::size_t>(w);
+      if(direct_ && done % columns_file_alignment != 0) {
+        // A short direct write leaves the file offset and the
+        // rest of the buffer unaligned, so the rest of the
+        // file is written through the page cache
+        disable_direct();
+      }
+    }
+    std::memmove(buffer_.get(), buffer_.get() + n, fill_ - n);
+    fill_ -= n;
+    written_ += n;
+  }
+
+  std::string path_;
+  int fd_ = -1;
+  // Whether the file was opened with O_DIRECT
+  bool direct_ = false;
+  std::size_t capacity_;
+  std::unique_ptr<unsigned char, buffer_deleter> buffer_;
+  std::size_t fill_ = 0;
+  std::uint64_t written_ = 0;
+};
+
+// Stages the values of a column, as many as fit in the
+// buffer at a time without testing for space per value
+template <typename T, typename iterator_>
+void write_column(aligned_file_writer &out,
+                  const iterator_ &col, const std::size_t n) {
+  for(std::size_t i = 0; i < n;) {
+    std::size_t available;
+    unsigned char *dest = out.next(available);
+    const std::size_t m =
+        std::min(n - i, available / sizeof(T));
+    for(std::size_t j = 0; j < m; j++) {
+      const T value = col[static_cast<std::ptrdiff_t>(i + j)];
+      std::memcpy(dest + j * sizeof(T), &value, sizeof(T));
+    }
+    out.commit(m * sizeof(T));
+    i += m;
+    if(m == 0) {
+      // The value straddles the end of the buffer
+      const T value = col[static_cast<std::ptrdiff_t>(i)];
+      out.put(&value, sizeof(T));
+      i++;
+    }
+  }
+}
+
+}  // namespace zip_internal_
+
+namespace zip {
+
+// Writes the rows of z to a columnar file at path, which
+// MappedColumns can map. Each column is written in turn,
+// through a staging buffer of options.buffer_size bytes, so
+// the file is written with large sequential writes rather
+// than a row at a time
+// write_columns("checkpoint.zip", make_zip(mass, pos, vel));
+// MappedColumns<double, vec3, vec3> checkpoint(
+//     "checkpoint.zip");
+// The columns' values must be trivially copyable
+template <typename zip_>
+void write_columns(const std::string &path, const zip_ &z,
+                   const write_options &options = {}) {
+  using value_type = typename zip_::value_type;
+  constexpr std::size_t num_columns =
+      std::tuple_size_v<value_type>;
+  const std::size_t n = z.size();
+  const auto r = zip_internal_::make_rows(z);
+
+  zip_internal_::columns_file_header header{
+      {}, zip_internal_::columns_file_version,
+      static_cast<std::uint32_t>(num_columns),
+      static_cast<std::uint64_t>(n)};
+  std::memcpy(header.magic, zip_internal_::columns_file_magic,
+              sizeof(header.magic));
+  zip_internal_::columns_file_column table[num_columns];
+  std::uint64_t offset =
+      zip_internal_::columns_file_header_size(num_columns);
+  zip_internal_::for_each_index<num_columns>([&](auto I) {
+    using column_type = std::tuple_element_t<I, value_type>;
+    static_assert(std::is_trivially_copyable_v<column_type>,
+                  "Written columns must be trivially copyable");
+    table[I] = {offset, sizeof(column_type)};
+    offset += zip_internal_::align_up(
+        n * sizeof(column_type),
+        zip_internal_::columns_file_alignment);
+  });
+
+  zip_internal_::aligned_file_writer out(path, options);
+  out.put(&header, sizeof(header));
+  out.put(table, sizeof(table));
+  out.pad();
+  zip_internal_::for_each_index<num_columns>([&](auto I) {
+    zip_internal_::write_column<
+        std::tuple_element_t<I, value_type>>(
+        out, std::get<I>(r.iterators()), n);
+    out.pad();
+  });
+  out.finish(options.sync);
+}
+
+}  // namespace zip
+
+#endif  // _ZIP_FILE_HPP_
@@ -2,7 +2,10 @@
 #ifndef _ZIP_INTERNAL_HPP_
 #define _ZIP_INTERNAL_HPP_
 
+#include <cstddef>
+#include <iterator>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 
 namespace zip_internal_ {
@@ -92,8 +95,9 @@ struct iterator_deref {
 };
 
 struct iterator_add {
-  int summand;
-  explicit iterator_add(const int s) : summand(s) {}
+  std::ptrdiff_t summand;
+  explicit iterator_add(const std::ptrdiff_t s)
+      : summand(s) {}
 
   template <typename iter_t>
   iter_t operator()(iter_t &i) {
@@ -132,10 +136,15 @@ auto tuple_transform(const std::tuple<Args...> &t, F f) {
       t, f, std::make_index_sequence<sizeof...(Args)>{});
 }
 
+// References returned by f are kept as references, while
+// values, such as the proxy references of packed
+// containers, are copied into the tuple rather than left
+// dangling
 template <class F, typename Tuple, size_t... Is>
 auto ref_tuple_transform_impl(Tuple &t, F f,
                         std::index_sequence<Is...>) {
-  return std::forward_as_tuple(f(std::get<Is>(t))...);
+  return std::tuple<decltype(f(std::get<Is>(t)))...>(
+      f(std::get<Is>(t))...);
 }
 
 template <class F, typename... Args>
@@ -147,7 +156,8 @@ auto ref_tuple_transform(std::tuple<Args...> &t, F f) {
 template <class F, typename Tuple, size_t... Is>
 auto ref_tuple_transform_impl(const Tuple &t, F f,
                         std::index_sequence<Is...>) {
-  return std::forward_as_tuple(f(std::get<Is>(t))...);
+  return std::tuple<decltype(f(std::get<Is>(t)))...>(
+      f(std::get<Is>(t))...);
 }
 
 template <class F, typename... Args>
@@ -156,6 +166,43 @@ auto ref_tuple_transform(const std::tuple<Args...> &t, F f) {
       t, f, std::make_index_sequence<sizeof...(Args)>{});
 }
 
+// The tuple of references to element i of each iterator
+template <typename reference, typename Tuple, size_t... Is>
+reference index_tuple_impl(const Tuple &t, const ptrdiff_t i,
+                           std::index_sequence<Is...>) {
+  return reference(std::get<Is>(t)[i]...);
+}
+
+template <typename reference, typename... Args>
+reference index_tuple(const std::tuple<Args...> &t,
+                      const ptrdiff_t i) {
+  return index_tuple_impl<reference>(
+      t, i, std::make_index_sequence<sizeof...(Args)>{});
+}
+
+// Calls f(std::integral_constant<size_t, I>()) for each I in
+// [0, n), so that f can use I as a tuple index
+template <class F, size_t... Is>
+void for_each_index_impl(F &&f, std::index_sequence<Is...>) {
+  (f(std::integral_constant<size_t, Is>()), ...);
+}
+
+template <size_t n, class F>
+void for_each_index(F &&f) {
+  for_each_index_impl(f, std::make_index_sequence<n>{});
+}
+
+// Calls f(std::integral_constant<size_t, I>()) for the I
+// equal to the runtime index i
+template <size_t n, class F>
+void visit_index(const size_t i, F &&f) {
+  for_each_index<n>([&](auto I) {
+    if(I == i) {
+      f(I);
+    }
+  });
+}
+
 }  // namespace zip_internal_
 
 namespace std {
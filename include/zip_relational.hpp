@@ -0,0 +1,1050 @@
+#ifndef _ZIP_RELATIONAL_HPP_
+#define _ZIP_RELATIONAL_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "zip_algorithm.hpp"
+
+// Relational operations over zips, treating each zip as a
+// table whose rows are borrowed from its containers. Key
+// columns are given as template parameters, and only those
+// columns are read while matching rows
+
+namespace zip_internal_ {
+
+// Fibonacci hashing spreads the bits of weak hashes, such as
+// the identity std::hash of integers, over a table of
+// 2^(64 - shift) slots
+constexpr std::size_t fibonacci_hash(
+    const std::size_t h, const unsigned shift) noexcept {
+  return static_cast<std::size_t>(
+      (static_cast<std::uint64_t>(h) * 0x9E3779B97F4A7C15ull) >>
+      shift);
+}
+
+// An open addressing table from the keys of group_by's
+// groups to their positions, with linear probing and at most
+// half of its power of two number of slots in use
+template <typename key_, typename hasher_>
+class group_table {
+ public:
+  group_table() : shift_(60), slots_(16) {}
+
+  // The position of the group with key, or next after
+  // inserting key with that position if it is absent
+  std::size_t find_or_insert(const key_ &key,
+                             const std::size_t next) {
+    const std::size_t mask = slots_.size() - 1;
+    std::size_t s = fibonacci_hash(hash_(key), shift_);
+    for(; slots_[s].position != empty; s = (s + 1) & mask) {
+      if(slots_[s].key == key) {
+        return slots_[s].position;
+      }
+    }
+    slots_[s] = {key, next};
+    if(2 * ++size_ > slots_.size()) {
+      grow();
+    }
+    return next;
+  }
+
+ private:
+  static constexpr std::size_t empty =
+      std::numeric_limits<std::size_t>::max();
+
+  struct slot {
+    key_ key{};
+    std::size_t position = empty;
+  };
+
+  void grow() {
+    std::vector<slot> old(2 * slots_.size());
+    std::swap(old, slots_);
+    shift_--;
+    const std::size_t mask = slots_.size() - 1;
+    for(auto &o : old) {
+      if(o.position != empty) {
+        std::size_t s = fibonacci_hash(hash_(o.key), shift_);
+        while(slots_[s].position != empty) {
+          s = (s + 1) & mask;
+        }
+        slots_[s] = std::move(o);
+      }
+    }
+  }
+
+  hasher_ hash_;
+  unsigned shift_;
+  std::size_t size_ = 0;
+  std::vector<slot> slots_;
+};
+
+}  // namespace zip_internal_
+
+namespace zip {
+
+enum class join_type {
+  // emit(row_a, row_b) for every pair of matching rows
+  inner,
+  // emit(row_a, std::optional<row_b>) for every pair of
+  // matching rows, and with std::nullopt for each row of a
+  // without a match
+  left,
+  // emit(row_a) once for each row of a with a match
+  semi,
+  // emit(row_a) once for each row of a without a match
+  anti
+};
+
+// Sort-merge join of a and b, which must both be sorted by
+// their key columns, key_a_ and key_b_, with comp. The
+// rows passed to emit are the tuples of references to the
+// rows of a and b, in the order of a
+// merge_join<0, 0>(make_zip(id, mass), make_zip(id2, charge),
+//                  [](const auto &a, const auto &b) {...});
+template <std::size_t key_a_, std::size_t key_b_,
+          join_type type_ = join_type::inner,
+          typename zip_a_, typename zip_b_, typename emit_,
+          typename compare_ = std::less<>>
+void merge_join(const zip_a_ &a, const zip_b_ &b, emit_ emit,
+                compare_ comp = {}) {
+  using reference_b = typename zip_b_::reference;
+  const auto rows_a = zip_internal_::make_rows(a);
+  const auto rows_b = zip_internal_::make_rows(b);
+  const auto &keys_a = std::get<key_a_>(rows_a.iterators());
+  const auto &keys_b = std::get<key_b_>(rows_b.iterators());
+  const auto n_a = static_cast<std::ptrdiff_t>(a.size());
+  const auto n_b = static_cast<std::ptrdiff_t>(b.size());
+
+  const auto unmatched = [&](const std::ptrdiff_t i) {
+    if constexpr(type_ == join_type::left) {
+      emit(rows_a[i], std::optional<reference_b>());
+    } else if constexpr(type_ == join_type::anti) {
+      emit(rows_a[i]);
+    }
+  };
+
+  std::ptrdiff_t i = 0, j = 0;
+  while(i < n_a && j < n_b) {
+    if(comp(keys_a[i], keys_b[j])) {
+      unmatched(i);
+      i++;
+    } else if(comp(keys_b[j], keys_a[i])) {
+      j++;
+    } else {
+      // The group of rows of b with this key
+      std::ptrdiff_t group_end = j + 1;
+      while(group_end < n_b &&
+            !comp(keys_a[i], keys_b[group_end])) {
+        group_end++;
+      }
+      do {
+        if constexpr(type_ == join_type::inner) {
+          for(std::ptrdiff_t k = j; k < group_end; k++) {
+            emit(rows_a[i], rows_b[k]);
+          }
+        } else if constexpr(type_ == join_type::left) {
+          for(std::ptrdiff_t k = j; k < group_end; k++) {
+            emit(rows_a[i], std::optional<reference_b>(
+                                rows_b[k]));
+          }
+        } else if constexpr(type_ == join_type::semi) {
+          emit(rows_a[i]);
+        }
+        i++;
+      } while(i < n_a && !comp(keys_b[j], keys_a[i]));
+      j = group_end;
+    }
+  }
+  for(; i < n_a; i++) {
+    unmatched(i);
+  }
+}
+
+// An open addressing hash table mapping the values of column
+// key_ of a zip to its row numbers, for repeated point
+// lookups and joins without sorting the zip. The table has a
+// power of two number of slots, at most half full, and
+// collisions are resolved by linear probing. Each slot holds
+// a copy of its key next to the row number, so a probe reads
+// one contiguous slot rather than the key column. Rows with
+// equal keys each have their own slot, and are found in the
+// order of the zip
+// The index refers to the zip's rows, and must be rebuilt if
+// they are reordered, inserted or removed
+template <std::size_t key_, typename zip_t_,
+          typename hasher_ = std::hash<std::tuple_element_t<
+              key_, typename zip_t_::value_type>>,
+          typename key_equal_ = std::equal_to<>>
+class HashIndex {
+ public:
+  using key_type =
+      std::tuple_element_t<key_, typename zip_t_::value_type>;
+  using size_type = typename zip_t_::size_type;
+  using iterator = typename zip_t_::iterator;
+
+  explicit HashIndex(const zip_t_ &z, hasher_ hash = {},
+                     key_equal_ equal = {})
+      : zip_(z), hash_(std::move(hash)),
+        equal_(std::move(equal)) {
+    const size_type n = z.size();
+    shift_ = 63;
+    while((std::size_t(1) << (64 - shift_)) < 2 * n) {
+      shift_--;
+    }
+    slots_.resize(std::size_t(1) << (64 - shift_));
+    const auto keys = std::get<key_>(z.begin().iterators());
+    const std::size_t mask = slots_.size() - 1;
+    for(size_type row = 0; row < n; row++) {
+      const key_type &key =
+          keys[static_cast<std::ptrdiff_t>(row)];
+      std::size_t s = home(key);
+      while(slots_[s].row != empty) {
+        s = (s + 1) & mask;
+      }
+      slots_[s].key = key;
+      slots_[s].row = row;
+    }
+  }
+
+  // Calls f(row_number) for each row with the key
+  template <typename F>
+  void for_each_row(const key_type &key, F f) const {
+    const std::size_t mask = slots_.size() - 1;
+    for(std::size_t s = home(key); slots_[s].row != empty;
+        s = (s + 1) & mask) {
+      if(equal_(slots_[s].key, key)) {
+        f(slots_[s].row);
+      }
+    }
+  }
+
+  // Calls f(row) with the tuple of references to each row
+  // with the key
+  template <typename F>
+  void for_each(const key_type &key, F f) const {
+    const zip_internal_::rows<iterator> r(zip_.begin());
+    for_each_row(key, [&](const size_type row) {
+      f(r[static_cast<std::ptrdiff_t>(row)]);
+    });
+  }
+
+  // An iterator to the first row with the key, or end()
+  iterator find(const key_type &key) const {
+    const std::size_t mask = slots_.size() - 1;
+    for(std::size_t s = home(key); slots_[s].row != empty;
+        s = (s + 1) & mask) {
+      if(equal_(slots_[s].key, key)) {
+        return zip_.begin() +
+               static_cast<std::ptrdiff_t>(slots_[s].row);
+      }
+    }
+    return zip_.end();
+  }
+
+  bool contains(const key_type &key) const {
+    return find(key) != zip_.end();
+  }
+
+  size_type count(const key_type &key) const {
+    size_type c = 0;
+    for_each_row(key, [&c](const size_type) { c++; });
+    return c;
+  }
+
+  const zip_t_ &zip() const noexcept { return zip_; }
+
+ protected:
+  static constexpr size_type empty =
+      std::numeric_limits<size_type>::max();
+
+  struct slot {
+    key_type key{};
+    size_type row = empty;
+  };
+
+  std::size_t home(const key_type &key) const {
+    return zip_internal_::fibonacci_hash(hash_(key), shift_);
+  }
+
+  zip_t_ zip_;
+  hasher_ hash_;
+  key_equal_ equal_;
+  // 64 - log2 of the number of slots
+  unsigned shift_;
+  std::vector<slot> slots_;
+};
+
+template <std::size_t key_, typename zip_>
+HashIndex<key_, zip_> hash_index(const zip_ &z) {
+  return HashIndex<key_, zip_>(z);
+}
+
+// Hash join of a with the zip of an index over b, probing
+// the index with column key_a_ of each row of a. emit is
+// called as for merge_join, in the order of a; neither zip
+// needs to be sorted. The index can be reused across joins
+// auto index = hash_index<0>(make_zip(id, charge));
+// hash_join<0>(make_zip(id2, mass), index,
+//              [](const auto &a, const auto &b) {...});
+template <std::size_t key_a_,
+          join_type type_ = join_type::inner,
+          typename zip_a_, typename index_, typename emit_>
+void hash_join(const zip_a_ &a, const index_ &index,
+               emit_ emit) {
+  using reference_b = typename index_::iterator::reference;
+  const auto rows_a = zip_internal_::make_rows(a);
+  const auto rows_b = zip_internal_::make_rows(index.zip());
+  const auto &keys_a = std::get<key_a_>(rows_a.iterators());
+  const auto n_a = static_cast<std::ptrdiff_t>(a.size());
+  for(std::ptrdiff_t i = 0; i < n_a; i++) {
+    // Semi and anti joins only need to find one match, so
+    // stop at the first rather than visiting every row of a
+    // skewed key
+    if constexpr(type_ == join_type::semi ||
+                 type_ == join_type::anti) {
+      if(index.contains(keys_a[i]) ==
+         (type_ == join_type::semi)) {
+        emit(rows_a[i]);
+      }
+      continue;
+    }
+    bool matched = false;
+    index.for_each_row(
+        keys_a[i], [&](const typename index_::size_type row) {
+          const auto j = static_cast<std::ptrdiff_t>(row);
+          if constexpr(type_ == join_type::inner) {
+            emit(rows_a[i], rows_b[j]);
+          } else if constexpr(type_ == join_type::left) {
+            emit(rows_a[i],
+                 std::optional<reference_b>(rows_b[j]));
+          }
+          matched = true;
+        });
+    if constexpr(type_ == join_type::left) {
+      if(!matched) {
+        emit(rows_a[i], std::optional<reference_b>());
+      }
+    }
+  }
+}
+
+// Builds a hash index over column key_b_ of b and joins a
+// with it
+template <std::size_t key_a_, std::size_t key_b_,
+          join_type type_ = join_type::inner,
+          typename zip_a_, typename zip_b_, typename emit_>
+void hash_join(const zip_a_ &a, const zip_b_ &b, emit_ emit) {
+  hash_join<key_a_, type_>(a, hash_index<key_b_>(b),
+                           std::move(emit));
+}
+
+// Aggregators for group_by
+// Each makes a state from the first row of a group with
+// init(row), adds the following rows to it with
+// update(state, row), combines the states of two parts of
+// a group with merge(state, other), and gives the value for
+// the group with result(state)
+
+// The sum of a column
+template <std::size_t column_>
+struct sum_of {
+  template <typename row_>
+  auto init(const row_ &row) const {
+    return std::get<column_>(row);
+  }
+  template <typename state_, typename row_>
+  void update(state_ &s, const row_ &row) const {
+    s += std::get<column_>(row);
+  }
+  template <typename state_>
+  void merge(state_ &s, const state_ &other) const {
+    s += other;
+  }
+  template <typename state_>
+  state_ result(const state_ &s) const {
+    return s;
+  }
+};
+
+// The smallest value of a column
+template <std::size_t column_>
+struct min_of : sum_of<column_> {
+  template <typename state_, typename row_>
+  void update(state_ &s, const row_ &row) const {
+    if(std::get<column_>(row) < s) {
+      s = std::get<column_>(row);
+    }
+  }
+  template <typename state_>
+  void merge(state_ &s, const state_ &other) const {
+    if(other < s) {
+      s = other;
+    }
+  }
+};
+
+// The largest value of a column
+template <std::size_t column_>
+struct max_of : sum_of<column_> {
+  template <typename state_, typename row_>
+  void update(state_ &s, const row_ &row) const {
+    if(s < std::get<column_>(row)) {
+      s = std::get<column_>(row);
+    }
+  }
+  template <typename state_>
+  void merge(state_ &s, const state_ &other) const {
+    if(s < other) {
+      s = other;
+    }
+  }
+};
+
+// The arithmetic mean of a column, as a double
+template <std::size_t column_>
+struct mean_of {
+  template <typename row_>
+  std::pair<double, std::size_t> init(const row_ &row) const {
+    return {static_cast<double>(std::get<column_>(row)), 1};
+  }
+  template <typename row_>
+  void update(std::pair<double, std::size_t> &s,
+              const row_ &row) const {
+    s.first += static_cast<double>(std::get<column_>(row));
+    s.second++;
+  }
+  void merge(std::pair<double, std::size_t> &s,
+             const std::pair<double, std::size_t> &other) const {
+    s.first += other.first;
+    s.second += other.second;
+  }
+  double result(const std::pair<double, std::size_t> &s) const {
+    return s.first / static_cast<double>(s.second);
+  }
+};
+
+// The number of rows
+struct count_of {
+  template <typename row_>
+  std::size_t init(const row_ &) const {
+    return 1;
+  }
+  template <typename row_>
+  void update(std::size_t &s, const row_ &) const {
+    s++;
+  }
+  void merge(std::size_t &s, const std::size_t &other) const {
+    s += other;
+  }
+  std::size_t result(const std::size_t &s) const { return s; }
+};
+
+}  // namespace zip
+
+namespace zip_internal_ {
+
+template <typename key_, typename states_>
+struct group {
+  key_ key;
+  states_ states;
+};
+
+// Builds the groups of rows [first, last), either from the
+// runs of equal keys when the keys are sorted, or with a
+// hash table
+template <bool sorted_, std::size_t key_, typename hasher_,
+          typename group_, typename rows_, typename... aggs_>
+std::vector<group_> group_rows(const rows_ &r,
+                               const std::ptrdiff_t first,
+                               const std::ptrdiff_t last,
+                               const std::tuple<aggs_...> &aggs) {
+  std::vector<group_> groups;
+  group_table<decltype(group_::key), hasher_> table;
+  const auto &keys = std::get<key_>(r.iterators());
+  for(std::ptrdiff_t i = first; i < last; i++) {
+    const auto row = r[i];
+    std::size_t g;
+    if constexpr(sorted_) {
+      g = groups.empty() || !(groups.back().key == keys[i])
+              ? groups.size()
+              : groups.size() - 1;
+    } else {
+      g = table.find_or_insert(keys[i], groups.size());
+    }
+    if(g == groups.size()) {
+      groups.push_back({keys[i], std::apply(
+                                     [&](const auto &... agg) {
+                                       return decltype(
+                                           group_::states){
+                                           agg.init(row)...};
+                                     },
+                                     aggs)});
+    } else {
+      for_each_index<sizeof...(aggs_)>([&](auto A) {
+        std::get<A>(aggs).update(
+            std::get<A>(groups[g].states), row);
+      });
+    }
+  }
+  return groups;
+}
+
+template <typename group_, typename... aggs_>
+void merge_group(group_ &g, const group_ &other,
+                 const std::tuple<aggs_...> &aggs) {
+  for_each_index<sizeof...(aggs_)>([&](auto A) {
+    std::get<A>(aggs).merge(std::get<A>(g.states),
+                            std::get<A>(other.states));
+  });
+}
+
+}  // namespace zip_internal_
+
+namespace zip {
+
+// Aggregates the rows of z grouped by the value of column
+// key_, returning a vector with one
+// std::tuple<key, aggregates...> per group
+// auto stats = group_by<0>(make_zip(sensor, value),
+//                          count_of(), mean_of<1>(),
+//                          max_of<1>());
+// When the key column is sorted, which is checked first,
+// groups are found from runs of equal keys and are returned
+// in key order. Otherwise they are found with a hash table
+// and returned in order of their first row. Keys must
+// support ==, < and std::hash, or the hasher_ given
+// With a policy as the second argument, each thread groups
+// its own chunk of rows into a private table, and the tables
+// are merged in order at the end
+template <std::size_t key_, typename hasher_ = void,
+          typename zip_t_, typename policy_, typename... aggs_,
+          typename = std::enable_if_t<
+              is_execution_policy_v<policy_>>>
+auto group_by(const zip_t_ &z, const policy_ &policy,
+              aggs_... aggs) {
+  using key_type =
+      std::tuple_element_t<key_, typename zip_t_::value_type>;
+  using hash_type =
+      std::conditional_t<std::is_void_v<hasher_>,
+                         std::hash<key_type>, hasher_>;
+  using reference = typename zip_t_::reference;
+  using states = std::tuple<decltype(
+      std::declval<const aggs_ &>().init(
+          std::declval<const reference &>()))...>;
+  using group = zip_internal_::group<key_type, states>;
+  using result_type = std::tuple<
+      key_type,
+      decltype(std::declval<const aggs_ &>().result(
+          std::declval<const decltype(
+              std::declval<const aggs_ &>().init(
+                  std::declval<const reference &>())) &>()))...>;
+
+  const std::size_t n = z.size();
+  const auto r = zip_internal_::make_rows(z);
+  const auto &keys = std::get<key_>(r.iterators());
+  const auto aggregators = std::make_tuple(aggs...);
+  const bool sorted = std::is_sorted(
+      keys, keys + static_cast<std::ptrdiff_t>(n));
+
+  const unsigned num_threads =
+      zip_internal_::combining_thread_count(policy, n);
+  std::vector<std::vector<group>> partial(num_threads);
+  zip_internal_::parallel_chunks(
+      n, num_threads,
+      [&](const unsigned t, const std::ptrdiff_t first,
+          const std::ptrdiff_t last) {
+        partial[t] =
+            sorted
+                ? zip_internal_::group_rows<true, key_, hash_type,
+                                            group>(r, first, last,
+                                                   aggregators)
+                : zip_internal_::group_rows<false, key_, hash_type,
+                                            group>(r, first, last,
+                                                   aggregators);
+      });
+
+  std::vector<group> groups = std::move(partial[0]);
+  zip_internal_::group_table<key_type, hash_type> table;
+  if(!sorted && num_threads > 1) {
+    for(std::size_t g = 0; g < groups.size(); g++) {
+      table.find_or_insert(groups[g].key, g);
+    }
+  }
+  for(unsigned t = 1; t < num_threads; t++) {
+    for(auto &other : partial[t]) {
+      std::size_t g;
+      if(sorted) {
+        // Only a group spanning the chunk boundary is shared
+        g = !groups.empty() && groups.back().key == other.key
+                ? groups.size() - 1
+                : groups.size();
+      } else {
+        g = table.find_or_insert(other.key, groups.size());
+      }
+      if(g == groups.size()) {
+        groups.push_back(std::move(other));
+      } else {
+        zip_internal_::merge_group(groups[g], other,
+                                   aggregators);
+      }
+    }
+  }
+
+  std::vector<result_type> results;
+  results.reserve(groups.size());
+  for(const auto &g : groups) {
+    results.push_back(std::apply(
+        [&](const auto &... agg) {
+          return std::apply(
+              [&](const auto &... state) {
+                return result_type(g.key, agg.result(state)...);
+              },
+              g.states);
+        },
+        aggregators));
+  }
+  return results;
+}
+
+template <std::size_t key_, typename hasher_ = void,
+          typename zip_t_, typename... aggs_,
+          typename = std::enable_if_t<
+              (!is_execution_policy_v<aggs_> && ...)>>
+auto group_by(const zip_t_ &z, aggs_... aggs) {
+  return group_by<key_, hasher_>(z, seq, aggs...);
+}
+
+}  // namespace zip
+
+namespace zip_internal_ {
+
+// Scatters the rows [first, last) of the column from to the
+// positions next[p] of their partitions in to. Trivially
+// copyable values are staged in a cache line sized buffer
+// per partition, which is written out whole when it fills,
+// so the writes to each partition stream a line at a time
+// rather than touching a new line of every partition per
+// row. Columns of proxy references are copied a value at a
+// time
+template <typename T, typename from_, typename to_>
+void radix_scatter(const from_ &from, const to_ &to,
+                   const std::vector<std::uint32_t> &parts,
+                   const std::ptrdiff_t first,
+                   const std::ptrdiff_t last,
+                   std::vector<std::size_t> next) {
+  if constexpr(std::is_trivially_copyable_v<T> &&
+                has_lvalue_references_v<from_> &&
+                has_lvalue_references_v<to_>) {
+    constexpr std::size_t per_line =
+        std::max(std::size_t(1), cache_line_size / sizeof(T));
+    struct alignas(cache_line_size) line {
+      unsigned char bytes[per_line * sizeof(T)];
+    };
+    std::vector<line> buffers(next.size());
+    std::vector<unsigned> fill(next.size());
+    const auto flush = [&](const std::uint32_t p) {
+      for(unsigned k = 0; k < fill[p]; k++) {
+        std::memcpy(&to[static_cast<std::ptrdiff_t>(next[p] + k)],
+                    buffers[p].bytes + k * sizeof(T), sizeof(T));
+      }
+      next[p] += fill[p];
+      fill[p] = 0;
+    };
+    for(std::ptrdiff_t i = first; i < last; i++) {
+      const std::uint32_t p = parts[i];
+      std::memcpy(buffers[p].bytes + fill[p] * sizeof(T),
+                  &from[i], sizeof(T));
+      if(++fill[p] == per_line) {
+        flush(p);
+      }
+    }
+    for(std::uint32_t p = 0; p < next.size(); p++) {
+      flush(p);
+    }
+  } else {
+    for(std::ptrdiff_t i = first; i < last; i++) {
+      to[static_cast<std::ptrdiff_t>(next[parts[i]]++)] =
+          from[i];
+    }
+  }
+}
+
+}  // namespace zip_internal_
+
+namespace zip {
+
+// Each thread keeps a count, and each column scatter a cache
+// line buffer, per partition, so 2^16 partitions take 4 MiB
+// of buffers and 512 KiB of counts per thread
+constexpr unsigned radix_partition_max_bits = 16;
+
+// Copies the rows of src into dest, which must have as many
+// rows, grouped into 2^bits partitions by the hash of their
+// key_ column. Rows keep their order within a partition, and
+// rows with equal keys share a partition. Returns the
+// 2^bits + 1 offsets of the partitions in dest, so partition
+// p is rows [offsets[p], offsets[p + 1])
+// Both sides of a join can be split into partitions small
+// enough to stay in cache and joined pairwise in parallel
+// auto offsets = radix_partition<0>(make_zip(ids, mass),
+//                                   make_zip(part_ids,
+//                                            part_mass),
+//                                   8, par);
+// Each column is scattered in turn through write combining
+// buffers, so bits should be small enough that a cache line
+// per partition fits in the L1 cache. Columns written
+// through proxy references, such as a Bitmask, are scattered
+// by one thread. The scratch memory is a count per thread
+// and a cache line per partition, so bits above
+// radix_partition_max_bits throw std::invalid_argument
+// bits of 0 copy the rows into a single partition
+template <std::size_t key_, typename hasher_ = void,
+          typename src_zip_, typename dest_zip_,
+          typename policy_ = sequenced_policy>
+std::vector<std::size_t> radix_partition(
+    const src_zip_ &src, const dest_zip_ &dest,
+    const unsigned bits, const policy_ &policy = {}) {
+  using value_type = typename src_zip_::value_type;
+  using key_type = std::tuple_element_t<key_, value_type>;
+  using hash_type =
+      std::conditional_t<std::is_void_v<hasher_>,
+                         std::hash<key_type>, hasher_>;
+  if(bits > radix_partition_max_bits) {
+    throw std::invalid_argument(
+        "radix_partition needs at most " +
+        std::to_string(radix_partition_max_bits) + " bits");
+  }
+  const std::size_t n = src.size();
+  const std::size_t num_parts = std::size_t(1) << bits;
+  const auto from = zip_internal_::make_rows(src);
+  const auto to = zip_internal_::make_rows(dest);
+  const unsigned num_threads =
+      zip_internal_::thread_count(policy, n);
+
+  // The partition of every row, and how many of each chunk's
+  // rows are in each partition
+  std::vector<std::uint32_t> parts(n);
+  std::vector<std::vector<std::size_t>> counts(
+      num_threads, std::vector<std::size_t>(num_parts));
+  zip_internal_::parallel_chunks(
+      n, num_threads,
+      [&](const unsigned t, const std::ptrdiff_t first,
+          const std::ptrdiff_t last) {
+        const hash_type hash{};
+        const auto &keys = std::get<key_>(from.iterators());
+        for(std::ptrdiff_t i = first; i < last; i++) {
+          parts[i] =
+              bits == 0
+                  ? 0
+                  : static_cast<std::uint32_t>(
+                        zip_internal_::fibonacci_hash(
+                            hash(keys[i]), 64 - bits));
+          counts[t][parts[i]]++;
+        }
+      });
+
+  // Each chunk writes its rows of a partition after those of
+  // the chunks before it
+  std::vector<std::size_t> offsets(num_parts + 1);
+  std::size_t total = 0;
+  for(std::size_t p = 0; p < num_parts; p++) {
+    offsets[p] = total;
+    for(unsigned t = 0; t < num_threads; t++) {
+      const std::size_t count = counts[t][p];
+      counts[t][p] = total;
+      total += count;
+    }
+  }
+  offsets[num_parts] = total;
+
+  zip_internal_::for_each_index<
+      std::tuple_size_v<value_type>>([&](auto I) {
+    using column_type = std::tuple_element_t<I, value_type>;
+    using to_iterator =
+        std::decay_t<decltype(std::get<I>(to.iterators()))>;
+    const auto scatter = [&](const unsigned t,
+                             const std::ptrdiff_t first,
+                             const std::ptrdiff_t last) {
+      zip_internal_::radix_scatter<column_type>(
+          std::get<I>(from.iterators()),
+          std::get<I>(to.iterators()), parts, first, last,
+          counts[t]);
+    };
+    if constexpr(zip_internal_::has_lvalue_references_v<
+                     to_iterator>) {
+      zip_internal_::parallel_chunks(n, num_threads, scatter);
+    } else {
+      // Proxies such as Bitmask's pack several rows into a
+      // word, so the chunks are written one after another
+      for(unsigned t = 0; t < num_threads; t++) {
+        scatter(t,
+                zip_internal_::chunk_begin(n, num_threads, t),
+                zip_internal_::chunk_begin(n, num_threads,
+                                           t + 1));
+      }
+    }
+  });
+  return offsets;
+}
+
+// Predicates for filter, selecting the rows with the value of
+// column_ in the closed range [lower, upper]. Besides testing
+// a value, a predicate tells from the bounds of a block of
+// the column whether it may match any, or matches all, of
+// its rows
+template <std::size_t column_, typename T>
+struct in_range {
+  static constexpr std::size_t column = column_;
+  T lower;
+  T upper;
+
+  template <typename U>
+  bool operator()(const U &value) const {
+    return !(value < lower) && !(upper < value);
+  }
+  template <typename U>
+  bool may_match(const U &min, const U &max) const {
+    return !(max < lower) && !(upper < min);
+  }
+  template <typename U>
+  bool matches_all(const U &min, const U &max) const {
+    return !(min < lower) && !(upper < max);
+  }
+};
+
+// filter(z, f, between<0>(t0, t1)) visits the rows with
+// t0 <= column 0 <= t1
+template <std::size_t column_, typename T>
+in_range<column_, T> between(T lower, T upper) {
+  return {std::move(lower), std::move(upper)};
+}
+
+template <std::size_t column_, typename T>
+in_range<column_, T> equals(T value) {
+  return {value, value};
+}
+
+// A zone map summarizes the columns columns_... of a zip by
+// their smallest and largest values in each block of
+// block_size rows, so that filter can skip the blocks which
+// cannot hold a matching row without reading them. It
+// suits columns which are close to sorted, such as times
+// of rows which are appended as they are recorded
+// auto zones = zone_map<0>(make_zip(time, pos, vel));
+// filter(zones, f, between<0>(t0, t1));
+// Rows appended to the containers after the zone map was
+// built are scanned until refresh is called, which only
+// summarizes the new rows and the last partial block. The
+// zone map must be rebuilt if rows are otherwise modified
+template <typename zip_t_, std::size_t... columns_>
+class ZoneMap {
+ public:
+  using value_type = typename zip_t_::value_type;
+  using size_type = typename zip_t_::size_type;
+
+  explicit ZoneMap(const zip_t_ &z,
+                   const size_type block_size = 4096)
+      : zip_(z), block_size_(std::max(block_size,
+                                       size_type(1))) {
+    refresh();
+  }
+
+  // Summarizes the rows added to the zip since the zone map
+  // was last built or refreshed
+  void refresh() {
+    const size_type n = zip_.size();
+    const size_type first_block = rows_ / block_size_;
+    const size_type blocks = (n + block_size_ - 1) / block_size_;
+    const zip_internal_::rows<typename zip_t_::iterator> r(
+        zip_.begin());
+    zip_internal_::for_each_index<sizeof...(columns_)>(
+        [&](auto c) {
+          const auto col =
+              std::get<column_at(c)>(r.iterators());
+          auto &bounds = std::get<c>(bounds_);
+          bounds.resize(first_block);
+          for(size_type b = first_block; b < blocks; b++) {
+            const auto first =
+                static_cast<std::ptrdiff_t>(b * block_size_);
+            const auto last = static_cast<std::ptrdiff_t>(
+                std::min(n, (b + 1) * block_size_));
+            const auto [min, max] =
+                std::minmax_element(col + first, col + last);
+            bounds.emplace_back(*min, *max);
+          }
+        });
+    rows_ = n;
+  }
+
+  const zip_t_ &zip() const noexcept { return zip_; }
+  size_type block_size() const noexcept {
+    return block_size_;
+  }
+  // The number of rows summarized by the blocks
+  size_type rows() const noexcept { return rows_; }
+  size_type num_blocks() const noexcept {
+    return (rows_ + block_size_ - 1) / block_size_;
+  }
+
+  // The smallest and largest value of column column in
+  // block b
+  template <std::size_t column>
+  const auto &bounds(const size_type b) const {
+    constexpr std::size_t c = position_of(column);
+    static_assert(c < sizeof...(columns_),
+                  "The column is not in the zone map");
+    return std::get<c>(bounds_)[b];
+  }
+
+  // Whether block b may hold rows matching pred, which is
+  // always the case for predicates of columns not in the
+  // zone map
+  template <typename pred_>
+  bool may_match(const size_type b, const pred_ &pred) const {
+    if constexpr(position_of(pred_::column) <
+                 sizeof...(columns_)) {
+      const auto &[min, max] = bounds<pred_::column>(b);
+      return pred.may_match(min, max);
+    } else {
+      return true;
+    }
+  }
+
+  // Whether all of the rows of block b match pred
+  template <typename pred_>
+  bool matches_all(const size_type b,
+                   const pred_ &pred) const {
+    if constexpr(position_of(pred_::column) <
+                 sizeof...(columns_)) {
+      const auto &[min, max] = bounds<pred_::column>(b);
+      return pred.matches_all(min, max);
+    } else {
+      return false;
+    }
+  }
+
+ protected:
+  static constexpr std::size_t column_at(
+      const std::size_t c) {
+    constexpr std::size_t columns[] = {columns_...};
+    return columns[c];
+  }
+  static constexpr std::size_t position_of(
+      const std::size_t column) {
+    constexpr std::size_t columns[] = {columns_...};
+    std::size_t c = 0;
+    while(c < sizeof...(columns_) && columns[c] != column) {
+      c++;
+    }
+    return c;
+  }
+
+  zip_t_ zip_;
+  size_type block_size_;
+  size_type rows_ = 0;
+  std::tuple<std::vector<std::pair<
+      std::tuple_element_t<columns_, value_type>,
+      std::tuple_element_t<columns_, value_type>>>...>
+      bounds_;
+};
+
+template <std::size_t... columns_, typename zip_>
+ZoneMap<zip_, columns_...> zone_map(
+    const zip_ &z,
+    const typename zip_::size_type block_size = 4096) {
+  return ZoneMap<zip_, columns_...>(z, block_size);
+}
+
+}  // namespace zip
+
+namespace zip_internal_ {
+
+// Calls f(row) for the rows [first, last) of r matching all
+// of preds, or for all of them without testing if all_match,
+// and returns the number of rows visited
+template <typename rows_, typename F, typename... preds_>
+std::size_t filter_rows(const rows_ &r,
+                        const std::ptrdiff_t first,
+                        const std::ptrdiff_t last,
+                        const bool all_match, F &f,
+                        const preds_ &... preds) {
+  if(all_match) {
+    for(std::ptrdiff_t i = first; i < last; i++) {
+      f(r[i]);
+    }
+    return static_cast<std::size_t>(last - first);
+  }
+  std::size_t count = 0;
+  for(std::ptrdiff_t i = first; i < last; i++) {
+    if((preds(std::get<preds_::column>(r.iterators())[i]) &&
+        ...)) {
+      f(r[i]);
+      count++;
+    }
+  }
+  return count;
+}
+
+}  // namespace zip_internal_
+
+namespace zip {
+
+// Calls f(row) with the tuple of references to each row of z
+// matching all of preds, in order, and returns the number
+// of matching rows
+// filter(make_zip(time, pos), f, between<0>(t0, t1));
+template <typename zip_, typename F, typename... preds_>
+typename zip_::size_type filter(const zip_ &z, F f,
+                                const preds_ &... preds) {
+  return zip_internal_::filter_rows(
+      zip_internal_::make_rows(z), 0,
+      static_cast<std::ptrdiff_t>(z.size()), false, f,
+      preds...);
+}
+
+// As filter over zones.zip(), skipping the blocks whose
+// bounds cannot match all of preds, and not testing the
+// rows of blocks whose bounds match all of them
+template <typename zip_t_, std::size_t... columns_,
+          typename F, typename... preds_>
+typename zip_t_::size_type filter(
+    const ZoneMap<zip_t_, columns_...> &zones, F f,
+    const preds_ &... preds) {
+  using size_type = typename zip_t_::size_type;
+  const auto r = zip_internal_::make_rows(zones.zip());
+  const size_type block_size = zones.block_size();
+  size_type count = 0;
+  for(size_type b = 0; b < zones.num_blocks(); b++) {
+    if(!(zones.may_match(b, preds) && ...)) {
+      continue;
+    }
+    const bool all_match = (zones.matches_all(b, preds) && ...);
+    count += zip_internal_::filter_rows(
+        r, static_cast<std::ptrdiff_t>(b * block_size),
+        static_cast<std::ptrdiff_t>(
+            std::min(zones.rows(), (b + 1) * block_size)),
+        all_match, f, preds...);
+  }
+  // Rows appended since the zone map was refreshed
+  count += zip_internal_::filter_rows(
+      r, static_cast<std::ptrdiff_t>(zones.rows()),
+      static_cast<std::ptrdiff_t>(zones.zip().size()), false,
+      f, preds...);
+  return count;
+}
+
+}  // namespace zip
+
+#endif  // _ZIP_RELATIONAL_HPP_
@@ -1,9 +1,24 @@
 
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <numeric>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 #include "zip.hpp"
+#include "zip_algorithm.hpp"
+#include "zip_bitmask.hpp"
+#include "zip_file.hpp"
+#include "zip_relational.hpp"
 
 TEST_CASE("get, difference, compare, increment, set",
           "[Zip]") {
@@ -137,3 +152,1370 @@ TEST_CASE("sort", "[Zip]") {
     i1_min = i1;
   }
 }
+
+TEST_CASE("slice, take, drop", "[Zip]") {
+  std::vector<int> v1(10), v2(10);
+  for(int i = 0; i < 10; i++) {
+    v1[i] = i;
+    v2[i] = 10 * i;
+  }
+  auto z = zip::make_zip(v1, v2);
+  REQUIRE(z.size() == 10);
+
+  auto s = z.slice(2, 7);
+  REQUIRE(s.size() == 5);
+  REQUIRE(s.begin() - z.begin() == 2);
+  REQUIRE(s.end() - z.begin() == 7);
+  int expected = 2;
+  for(auto [i1, i2] : s) {
+    REQUIRE(i1 == expected);
+    REQUIRE(i2 == 10 * expected);
+    expected++;
+  }
+  REQUIRE(expected == 7);
+
+  REQUIRE(z.take(3).size() == 3);
+  REQUIRE(z.take(3).begin() == z.begin());
+  REQUIRE(z.take(30).size() == 10);
+  REQUIRE(z.drop(4).size() == 6);
+  REQUIRE(z.drop(4).begin() - z.begin() == 4);
+  REQUIRE(z.drop(30).empty());
+
+  auto nested = s.drop(1).take(2);
+  REQUIRE(nested.size() == 2);
+  REQUIRE(std::get<0>(*nested.begin()) == 3);
+
+  for(auto [i1, i2] : z.drop(8)) {
+    i2 = -i1;
+  }
+  REQUIRE(v2[8] == -8);
+  REQUIRE(v2[9] == -9);
+  REQUIRE(v2[7] == 70);
+}
+
+TEST_CASE("project", "[Zip]") {
+  std::vector<int> v1{1, 2, 3}, v2{4, 5, 6};
+  std::vector<double> v3{0.5, 1.5, 2.5};
+  std::vector<char> v4{'a', 'b', 'c'};
+  auto z = zip::make_zip(v1, v2, v3, v4);
+
+  auto p = zip::project<2, 0>(z);
+  static_assert(
+      std::is_same_v<decltype(p),
+                     zip::Zip<std::random_access_iterator_tag,
+                              std::vector<double>,
+                              std::vector<int>>>);
+  REQUIRE(p.size() == 3);
+  REQUIRE(&std::get<0>(p.contents_) == &v3);
+  REQUIRE(&std::get<1>(p.contents_) == &v1);
+  for(auto [d, i] : p) {
+    i = static_cast<int>(2 * d);
+  }
+  REQUIRE((v1 == std::vector<int>{1, 3, 5}));
+
+  auto s = zip::project<3>(z.drop(1));
+  REQUIRE(s.size() == 2);
+  REQUIRE(std::get<0>(*s.begin()) == 'b');
+
+  auto ci = z.cbegin().project<1>();
+  REQUIRE(std::get<0>(*ci) == 4);
+}
+
+TEST_CASE("reverse iteration", "[Zip]") {
+  std::vector<int> v1{0, 1, 2, 3, 4}, v2{0, 10, 20, 30, 40};
+  auto z = zip::make_zip(v1, v2);
+  REQUIRE(z.rend() - z.rbegin() == 5);
+  REQUIRE(z.rbegin().base() == z.end());
+  REQUIRE(z.rend().base() == z.begin());
+  REQUIRE(z.rbegin() < z.rend());
+
+  int expected = 4;
+  for(auto [i1, i2] : z.reversed()) {
+    REQUIRE(i1 == expected);
+    REQUIRE(i2 == 10 * expected);
+    expected--;
+  }
+  REQUIRE(expected == -1);
+
+  auto ri = z.rbegin() + 2;
+  REQUIRE(std::get<0>(*ri) == 2);
+  ri--;
+  REQUIRE(std::get<0>(*ri) == 3);
+  REQUIRE(std::get<1>(*(z.crend() - 1)) == 0);
+
+  // Back substitution style sweep
+  for(auto ri = z.rbegin() + 1; ri != z.rend(); ++ri) {
+    std::get<1>(*ri) += std::get<1>(*(ri - 1));
+  }
+  REQUIRE((v2 == std::vector<int>{100, 100, 90, 70, 40}));
+
+  std::sort(z.rbegin(), z.rend(),
+            [](const decltype(z)::value_type &lhs,
+               const decltype(z)::value_type &rhs) {
+              return std::get<0>(lhs) < std::get<0>(rhs);
+            });
+  REQUIRE((v1 == std::vector<int>{4, 3, 2, 1, 0}));
+  REQUIRE((v2 == std::vector<int>{40, 70, 90, 100, 100}));
+
+  std::vector<int> e1, e2;
+  auto empty = zip::make_zip(e1, e2);
+  REQUIRE(empty.rbegin() == empty.rend());
+  REQUIRE(empty.crbegin() == empty.crend());
+  REQUIRE(empty.reversed().empty());
+  REQUIRE(empty.rend().base() == empty.begin());
+}
+
+TEST_CASE("reduce, transform_reduce", "[Zip]") {
+  std::vector<long> v1(10000), v2(10000);
+  std::random_device rd;
+  std::mt19937_64 rng(rd());
+  std::uniform_int_distribution<long> pdf(-1000, 1000);
+  long expected_dot = 0, expected_sum_1 = 0,
+       expected_sum_2 = 0;
+  for(auto [i1, i2] : zip::make_zip(v1, v2)) {
+    i1 = pdf(rng);
+    i2 = pdf(rng);
+    expected_dot += i1 * i2;
+    expected_sum_1 += i1;
+    expected_sum_2 += i2;
+  }
+  auto z = zip::make_zip(v1, v2);
+  auto dot = [](const auto &row) {
+    auto [i1, i2] = row;
+    return i1 * i2;
+  };
+  const zip::parallel_policy par{4, 1};
+
+  REQUIRE(zip::transform_reduce(z, 0l, std::plus<>(), dot) ==
+          expected_dot);
+  REQUIRE(zip::transform_reduce(z, 0l, std::plus<>(), dot,
+                                par) == expected_dot);
+  REQUIRE(zip::transform_reduce(z, 5l, std::plus<>(), dot,
+                                zip::par) == expected_dot + 5);
+  REQUIRE(zip::transform_reduce(z.take(3), 0l, std::plus<>(),
+                                dot, par) ==
+          v1[0] * v2[0] + v1[1] * v2[1] + v1[2] * v2[2]);
+  REQUIRE(zip::transform_reduce(z.take(0), 7l, std::plus<>(),
+                                dot, par) == 7);
+
+  using value_type = decltype(z)::value_type;
+  REQUIRE((zip::reduce(z, value_type{0, 0},
+                       zip::elementwise<std::plus<>>(), par) ==
+           value_type{expected_sum_1, expected_sum_2}));
+  REQUIRE((zip::reduce(zip::project<1>(z.drop(1)),
+                       std::tuple<long>{v2[0]},
+                       zip::elementwise<std::plus<>>()) ==
+           std::tuple<long>{expected_sum_2}));
+}
+
+TEST_CASE("deterministic reduce", "[Zip]") {
+  std::vector<double> v1(10007), v2(10007);
+  std::random_device rd;
+  std::mt19937_64 rng(rd());
+  std::uniform_real_distribution<double> pdf(-1.0e6, 1.0e6);
+  for(auto [d1, d2] : zip::make_zip(v1, v2)) {
+    d1 = pdf(rng);
+    d2 = pdf(rng);
+  }
+  auto z = zip::make_zip(v1, v2);
+  auto dot = [](const auto &row) {
+    auto [d1, d2] = row;
+    return d1 * d2;
+  };
+  for(std::size_t chunk_size : {1, 64, 1000, 20000}) {
+    const double expected = zip::transform_reduce(
+        z, 0.0, std::plus<>(), dot,
+        zip::deterministic_policy{1, chunk_size});
+    for(unsigned threads : {2, 3, 7, 0}) {
+      const double sum = zip::transform_reduce(
+          z, 0.0, std::plus<>(), dot,
+          zip::deterministic_policy{threads, chunk_size});
+      REQUIRE(std::memcmp(&sum, &expected, sizeof(sum)) == 0);
+    }
+  }
+  REQUIRE(zip::transform_reduce(z.take(0), 1.5, std::plus<>(),
+                                dot, zip::deterministic) ==
+          1.5);
+  std::vector<long> v3(5000, 3);
+  auto z3 = zip::make_zip(v3);
+  REQUIRE(zip::reduce(z3, std::tuple<long>{2},
+                      zip::elementwise<std::plus<>>(),
+                      zip::deterministic_policy{4, 7}) ==
+          std::tuple<long>{15002});
+}
+
+TEST_CASE("inclusive_scan, exclusive_scan", "[Zip]") {
+  std::vector<long> v1(5003), v2(5003);
+  std::random_device rd;
+  std::mt19937_64 rng(rd());
+  std::uniform_int_distribution<long> pdf(0, 100);
+  for(auto [i1, i2] : zip::make_zip(v1, v2)) {
+    i1 = pdf(rng);
+    i2 = pdf(rng);
+  }
+  std::vector<long> sum_1(v1.size()), sum_2(v2.size());
+  std::partial_sum(v1.begin(), v1.end(), sum_1.begin());
+  std::partial_sum(v2.begin(), v2.end(), sum_2.begin());
+  const auto sum = zip::elementwise<std::plus<>>();
+  using value_type = std::tuple<long, long>;
+
+  for(unsigned threads : {1, 2, 3, 8}) {
+    const zip::parallel_policy par{threads, 1};
+    std::vector<long> out_1(v1.size()), out_2(v2.size());
+    auto in = zip::make_zip(v1, v2);
+    auto out = zip::make_zip(out_1, out_2);
+
+    REQUIRE((zip::inclusive_scan(in, out, sum, par) ==
+             value_type{sum_1.back(), sum_2.back()}));
+    REQUIRE(out_1 == sum_1);
+    REQUIRE(out_2 == sum_2);
+
+    REQUIRE((zip::inclusive_scan(in, out, sum,
+                                 value_type{1, 2}, par) ==
+             value_type{sum_1.back() + 1, sum_2.back() + 2}));
+    REQUIRE(out_1[0] == v1[0] + 1);
+    REQUIRE(out_2.back() == sum_2.back() + 2);
+
+    REQUIRE((zip::exclusive_scan(in, out, value_type{0, 0},
+                                 sum, par) ==
+             value_type{sum_1.back(), sum_2.back()}));
+    REQUIRE(out_1[0] == 0);
+    REQUIRE(out_2[0] == 0);
+    for(std::size_t i = 1; i < v1.size(); i++) {
+      REQUIRE(out_1[i] == sum_1[i - 1]);
+      REQUIRE(out_2[i] == sum_2[i - 1]);
+    }
+
+    // In place
+    std::vector<long> inplace(v1);
+    auto z = zip::make_zip(inplace);
+    zip::exclusive_scan(z, z, std::tuple<long>{0}, sum, par);
+    REQUIRE(inplace[0] == 0);
+    REQUIRE(inplace.back() == sum_1[sum_1.size() - 2]);
+  }
+  // Floating point scans under deterministic_policy match the
+  // sequential scan exactly
+  std::vector<double> d(v1.begin(), v1.end());
+  for(double &x : d) {
+    x *= 0.1;
+  }
+  std::vector<double> seq_out(d.size()), det_out(d.size());
+  auto dz = zip::make_zip(d);
+  const auto seq_total =
+      zip::inclusive_scan(dz, zip::make_zip(seq_out), sum);
+  REQUIRE(zip::inclusive_scan(dz, zip::make_zip(det_out), sum,
+                              zip::deterministic) == seq_total);
+  REQUIRE(det_out == seq_out);
+  REQUIRE(zip::exclusive_scan(dz, zip::make_zip(det_out),
+                              std::tuple<double>{0.0}, sum,
+                              zip::deterministic) == seq_total);
+
+  std::vector<long> empty;
+  auto z = zip::make_zip(empty);
+  REQUIRE(zip::inclusive_scan(z, z, sum, zip::par) ==
+          std::tuple<long>{0});
+  REQUIRE(zip::exclusive_scan(z, z, std::tuple<long>{4}, sum) ==
+          std::tuple<long>{4});
+}
+
+TEST_CASE("compact", "[Zip]") {
+  for(unsigned threads : {1, 2, 4}) {
+    const zip::parallel_policy par{threads, 1};
+    std::vector<int> ids(1000);
+    std::vector<double> pos(1000);
+    std::vector<std::string> names(1000);
+    for(int i = 0; i < 1000; i++) {
+      ids[i] = i;
+      pos[i] = 0.5 * i;
+      names[i] = std::to_string(i);
+    }
+    auto z = zip::make_zip(ids, pos, names);
+    const auto n = zip::compact(
+        z,
+        [](const auto &row) { return std::get<0>(row) % 3 == 1; },
+        par);
+    REQUIRE(n == 667);
+    for(std::size_t i = 0; i < n; i++) {
+      const int expected = static_cast<int>(i / 2 * 3 + i % 2 * 2);
+      REQUIRE(ids[i] == expected);
+      REQUIRE(pos[i] == 0.5 * expected);
+      REQUIRE(names[i] == std::to_string(expected));
+    }
+  }
+  std::vector<int> v{1, 2, 3};
+  auto z = zip::make_zip(v);
+  REQUIRE(zip::compact(z, [](const auto &) { return false; }) ==
+          3);
+  REQUIRE((v == std::vector<int>{1, 2, 3}));
+  REQUIRE(zip::compact(z.drop(1),
+                       [](const auto &) { return true; }) == 0);
+  REQUIRE(v[0] == 1);
+}
+
+TEST_CASE("columns", "[Zip]") {
+  std::vector<int> ids;
+  std::vector<double> pos;
+  std::vector<std::string> names;
+  auto cols = zip::columns(zip::make_zip(ids, pos, names));
+  REQUIRE(cols.size() == 0);
+
+  cols.reserve(4);
+  REQUIRE(cols.capacity() >= 4);
+  for(int i = 0; i < 10; i++) {
+    cols.push_back({i, 0.5 * i, std::to_string(i)});
+    REQUIRE(ids.capacity() == pos.capacity());
+    REQUIRE(ids.capacity() == names.capacity());
+  }
+  REQUIRE(cols.size() == 10);
+  REQUIRE(names[9] == "9");
+
+  cols.erase(2, 5);
+  REQUIRE(cols.size() == 7);
+  REQUIRE(ids.size() == 7);
+  REQUIRE(pos.size() == 7);
+  REQUIRE(names.size() == 7);
+  REQUIRE(ids[2] == 5);
+  REQUIRE(pos[2] == 2.5);
+  REQUIRE(names[2] == "5");
+
+  std::vector<int> more_ids{100, 101, 102};
+  std::vector<double> more_pos{1.0, 2.0, 3.0};
+  std::vector<std::string> more_names{"a", "b", "c"};
+  cols.append(
+      zip::make_zip(more_ids, more_pos, more_names).drop(1));
+  REQUIRE(cols.size() == 9);
+  REQUIRE(ids[7] == 101);
+  REQUIRE(pos[8] == 3.0);
+  REQUIRE(names[8] == "c");
+
+  cols.resize(20);
+  REQUIRE(names.size() == 20);
+  REQUIRE(ids[19] == 0);
+
+  for(auto [i, p, n] : cols.zip().take(2)) {
+    i = -1;
+  }
+  REQUIRE(ids[1] == -1);
+  cols.clear();
+  REQUIRE(pos.empty());
+
+  // A column whose copy throws leaves the columns equally
+  // long
+  struct fragile {
+    bool fail = false;
+    fragile() = default;
+    explicit fragile(const bool f) : fail(f) {}
+    fragile(const fragile &src) : fail(src.fail) {
+      if(fail) {
+        throw std::runtime_error("copy");
+      }
+    }
+    fragile(fragile &&) noexcept = default;
+    fragile &operator=(const fragile &) = default;
+    fragile &operator=(fragile &&) noexcept = default;
+  };
+  std::vector<std::string> labels;
+  std::vector<fragile> values;
+  auto guarded = zip::columns(zip::make_zip(labels, values));
+  guarded.push_back({"a", fragile(false)});
+  const std::tuple<std::string, fragile> bad{"b", fragile(true)};
+  REQUIRE_THROWS_AS(guarded.push_back(bad),
+                    const std::runtime_error &);
+  REQUIRE(labels.size() == 1);
+  REQUIRE(values.size() == 1);
+
+  std::vector<std::string> more_labels{"c", "d"};
+  std::vector<fragile> more_values(2);
+  more_values[1].fail = true;
+  REQUIRE_THROWS_AS(guarded.append(zip::make_zip(more_labels,
+                                                 more_values)),
+                    const std::runtime_error &);
+  REQUIRE(labels.size() == 1);
+  REQUIRE(values.size() == 1);
+  REQUIRE(labels[0] == "a");
+}
+
+TEST_CASE("gather, scatter", "[Zip]") {
+  std::vector<int> v1{0, 1, 2, 3, 4, 5};
+  std::vector<double> v2{0.0, 0.5, 1.0, 1.5, 2.0, 2.5};
+  std::vector<std::size_t> order{5, 3, 1, 0, 2, 4};
+  auto z = zip::make_zip(v1, v2);
+  auto g = zip::gather(z, order);
+  REQUIRE(g.size() == 6);
+  REQUIRE(g.end() - g.begin() == 6);
+  std::size_t k = 0;
+  for(auto [i, d] : g) {
+    REQUIRE(i == static_cast<int>(order[k]));
+    REQUIRE(d == 0.5 * order[k]);
+    k++;
+  }
+  REQUIRE(std::get<0>(g[1]) == 3);
+  REQUIRE(std::get<0>(*(g.begin() + 4)) == 2);
+  std::get<0>(g[0]) = 50;
+  REQUIRE(v1[5] == 50);
+
+  std::vector<int> w1(6);
+  std::vector<double> w2(6);
+  auto src = zip::make_zip(v1, v2);
+  auto dest = zip::make_zip(w1, w2);
+  zip::scatter(src, order, dest, zip::parallel_policy{3, 1});
+  for(std::size_t i = 0; i < order.size(); i++) {
+    REQUIRE(w1[order[i]] == v1[i]);
+    REQUIRE(w2[order[i]] == v2[i]);
+  }
+}
+
+TEST_CASE("apply_permutation", "[Zip]") {
+  std::random_device rd;
+  std::mt19937_64 rng(rd());
+  const std::size_t n = 2000;
+  std::vector<int> perm(n);
+  std::iota(perm.begin(), perm.end(), 0);
+  std::shuffle(perm.begin(), perm.end(), rng);
+  const std::vector<int> original_perm(perm);
+
+  std::vector<int> ids(n);
+  std::vector<std::string> names(n);
+  auto z = zip::make_zip(ids, names);
+  const auto reset = [&]() {
+    for(std::size_t i = 0; i < n; i++) {
+      ids[i] = static_cast<int>(i);
+      names[i] = std::to_string(i);
+    }
+  };
+
+  reset();
+  zip::apply_permutation(z, perm);
+  REQUIRE(perm == original_perm);
+  for(std::size_t i = 0; i < n; i++) {
+    REQUIRE(ids[i] == perm[i]);
+    REQUIRE(names[i] == std::to_string(perm[i]));
+  }
+
+  reset();
+  zip::apply_permutation(z, perm, zip::parallel_policy{4, 1});
+  for(std::size_t i = 0; i < n; i++) {
+    REQUIRE(ids[i] == perm[i]);
+    REQUIRE(names[i] == std::to_string(perm[i]));
+  }
+
+  std::vector<std::size_t> rotate{1, 2, 0};
+  std::vector<double> d{0.0, 1.0, 2.0};
+  auto zd = zip::make_zip(d);
+  zip::apply_permutation(zd, rotate);
+  REQUIRE((d == std::vector<double>{1.0, 2.0, 0.0}));
+  REQUIRE((rotate == std::vector<std::size_t>{1, 2, 0}));
+}
+
+TEST_CASE("lower_bound, upper_bound, equal_range", "[Zip]") {
+  std::vector<int> keys{1, 3, 3, 3, 5, 8, 8, 13};
+  std::vector<char> values{'a', 'b', 'c', 'd', 'e', 'f', 'g',
+                           'h'};
+  auto z = zip::make_zip(values, keys);
+  for(int key = 0; key < 15; key++) {
+    REQUIRE(zip::lower_bound<1>(z, key) - z.begin() ==
+            std::lower_bound(keys.begin(), keys.end(), key) -
+                keys.begin());
+    REQUIRE(zip::upper_bound<1>(z, key) - z.begin() ==
+            std::upper_bound(keys.begin(), keys.end(), key) -
+                keys.begin());
+  }
+  auto r = zip::equal_range<1>(z, 3);
+  REQUIRE(r.size() == 3);
+  REQUIRE(std::get<0>(*r.begin()) == 'b');
+  REQUIRE(zip::equal_range<1>(z, 4).empty());
+  REQUIRE(zip::lower_bound<1>(z.drop(2), 5) - z.begin() == 4);
+
+  std::vector<int> descending{9, 7, 7, 2};
+  auto zd = zip::make_zip(descending);
+  REQUIRE(zip::equal_range<0>(zd, 7, std::greater<>()).size() ==
+          2);
+  std::vector<int> empty;
+  auto ze = zip::make_zip(empty);
+  REQUIRE(zip::lower_bound<0>(ze, 1) == ze.end());
+}
+
+TEST_CASE("merge, inplace_merge", "[Zip]") {
+  std::random_device rd;
+  std::mt19937_64 rng(rd());
+  std::uniform_int_distribution<int> pdf(0, 50);
+  std::vector<int> k1(300), k2(200);
+  std::vector<std::string> s1(300), s2(200);
+  for(auto &k : k1) {
+    k = pdf(rng);
+  }
+  for(auto &k : k2) {
+    k = pdf(rng);
+  }
+  std::sort(k1.begin(), k1.end());
+  std::sort(k2.begin(), k2.end());
+  for(std::size_t i = 0; i < k1.size(); i++) {
+    s1[i] = "a" + std::to_string(i);
+  }
+  for(std::size_t i = 0; i < k2.size(); i++) {
+    s2[i] = "b" + std::to_string(i);
+  }
+  const auto by_key = [](const auto &lhs, const auto &rhs) {
+    return std::get<0>(lhs) < std::get<0>(rhs);
+  };
+
+  // Reference result from std::merge over pairs
+  std::vector<std::pair<int, std::string>> p1, p2, expected;
+  for(std::size_t i = 0; i < k1.size(); i++) {
+    p1.emplace_back(k1[i], s1[i]);
+  }
+  for(std::size_t i = 0; i < k2.size(); i++) {
+    p2.emplace_back(k2[i], s2[i]);
+  }
+  std::merge(p1.begin(), p1.end(), p2.begin(), p2.end(),
+             std::back_inserter(expected),
+             [](const auto &lhs, const auto &rhs) {
+               return lhs.first < rhs.first;
+             });
+
+  std::vector<int> k_out(500);
+  std::vector<std::string> s_out(500);
+  auto out = zip::make_zip(k_out, s_out);
+  auto end = zip::merge(zip::make_zip(k1, s1),
+                        zip::make_zip(k2, s2), out, by_key);
+  REQUIRE(end == out.end());
+  for(std::size_t i = 0; i < expected.size(); i++) {
+    REQUIRE(k_out[i] == expected[i].first);
+    REQUIRE(s_out[i] == expected[i].second);
+  }
+
+  std::vector<int> k_all(k1);
+  std::vector<std::string> s_all(s1);
+  k_all.insert(k_all.end(), k2.begin(), k2.end());
+  s_all.insert(s_all.end(), s2.begin(), s2.end());
+  zip::inplace_merge(zip::make_zip(k_all, s_all), k1.size(),
+                     by_key);
+  REQUIRE(k_all == k_out);
+  REQUIRE(s_all == s_out);
+
+  std::vector<int> sorted{1, 2, 3, 4};
+  zip::inplace_merge(zip::make_zip(sorted), 2);
+  REQUIRE((sorted == std::vector<int>{1, 2, 3, 4}));
+  std::vector<int> swapped{3, 4, 1, 2};
+  zip::inplace_merge(zip::make_zip(swapped), 2);
+  REQUIRE((swapped == std::vector<int>{1, 2, 3, 4}));
+}
+
+TEST_CASE("merge_join", "[Zip]") {
+  std::vector<int> ids_a{1, 2, 2, 4, 6, 7};
+  std::vector<char> tags{'a', 'b', 'c', 'd', 'e', 'f'};
+  std::vector<double> values{0.5, 1.5, 2.5, 3.5};
+  std::vector<int> ids_b{2, 2, 3, 6};
+  auto za = zip::make_zip(ids_a, tags);
+  auto zb = zip::make_zip(values, ids_b);
+
+  std::vector<std::pair<char, double>> inner;
+  zip::merge_join<0, 1>(za, zb,
+                        [&](const auto &a, const auto &b) {
+                          inner.emplace_back(std::get<1>(a),
+                                             std::get<0>(b));
+                        });
+  REQUIRE((inner == std::vector<std::pair<char, double>>{
+                        {'b', 0.5},
+                        {'b', 1.5},
+                        {'c', 0.5},
+                        {'c', 1.5},
+                        {'e', 3.5}}));
+
+  std::vector<std::pair<char, double>> left;
+  zip::merge_join<0, 1, zip::join_type::left>(
+      za, zb, [&](const auto &a, const auto &b) {
+        left.emplace_back(std::get<1>(a),
+                          b ? std::get<0>(*b) : -1.0);
+      });
+  REQUIRE((left == std::vector<std::pair<char, double>>{
+                       {'a', -1.0},
+                       {'b', 0.5},
+                       {'b', 1.5},
+                       {'c', 0.5},
+                       {'c', 1.5},
+                       {'d', -1.0},
+                       {'e', 3.5},
+                       {'f', -1.0}}));
+
+  std::string semi, anti;
+  zip::merge_join<0, 1, zip::join_type::semi>(
+      za, zb,
+      [&](const auto &a) { semi.push_back(std::get<1>(a)); });
+  zip::merge_join<0, 1, zip::join_type::anti>(
+      za, zb,
+      [&](const auto &a) { anti.push_back(std::get<1>(a)); });
+  REQUIRE(semi == "bce");
+  REQUIRE(anti == "adf");
+
+  // Rows emitted by a join can be written through
+  zip::merge_join<0, 1>(za, zb, [](const auto &a, const auto &) {
+    std::get<1>(a) = 'z';
+  });
+  REQUIRE(tags[1] == 'z');
+  REQUIRE(tags[0] == 'a');
+}
+
+TEST_CASE("hash_index, hash_join", "[Zip]") {
+  std::vector<int> ids{40, 10, 30, 10, 20, 50};
+  std::vector<char> tags{'a', 'b', 'c', 'd', 'e', 'f'};
+  auto zb = zip::make_zip(ids, tags);
+  auto index = zip::hash_index<0>(zb);
+  REQUIRE(index.count(10) == 2);
+  REQUIRE(index.count(60) == 0);
+  REQUIRE(index.contains(50));
+  REQUIRE(!index.contains(0));
+  REQUIRE(index.find(30) - zb.begin() == 2);
+  REQUIRE(index.find(31) == zb.end());
+  std::string found;
+  index.for_each(10, [&](const auto &row) {
+    found.push_back(std::get<1>(row));
+  });
+  REQUIRE(found == "bd");
+
+  std::vector<int> probe{10, 60, 20};
+  std::vector<double> weights{1.0, 2.0, 3.0};
+  auto za = zip::make_zip(weights, probe);
+  std::vector<std::pair<double, char>> inner;
+  zip::hash_join<1>(za, index,
+                    [&](const auto &a, const auto &b) {
+                      inner.emplace_back(std::get<0>(a),
+                                         std::get<1>(b));
+                    });
+  REQUIRE((inner == std::vector<std::pair<double, char>>{
+                        {1.0, 'b'}, {1.0, 'd'}, {3.0, 'e'}}));
+  std::vector<std::pair<double, char>> left;
+  zip::hash_join<1, 0, zip::join_type::left>(
+      za, zb, [&](const auto &a, const auto &b) {
+        left.emplace_back(std::get<0>(a),
+                          b ? std::get<1>(*b) : '-');
+      });
+  REQUIRE((left == std::vector<std::pair<double, char>>{
+                       {1.0, 'b'}, {1.0, 'd'}, {2.0, '-'},
+                       {3.0, 'e'}}));
+  std::vector<double> anti;
+  zip::hash_join<1, zip::join_type::anti>(
+      za, index,
+      [&](const auto &a) { anti.push_back(std::get<0>(a)); });
+  REQUIRE((anti == std::vector<double>{2.0}));
+
+  // Many colliding keys
+  std::vector<long> many(10000);
+  for(std::size_t i = 0; i < many.size(); i++) {
+    many[i] = static_cast<long>(i % 2500) * 1024;
+  }
+  auto zm = zip::make_zip(many);
+  auto many_index = zip::hash_index<0>(zm);
+  for(long k = 0; k < 2500; k++) {
+    REQUIRE(many_index.count(k * 1024) == 4);
+  }
+  REQUIRE(many_index.count(1) == 0);
+
+  // Semi and anti joins emit each probe row once, and stop at
+  // the first match of a skewed key
+  struct counting_equal {
+    std::size_t *calls;
+    bool operator()(const int a, const int b) const {
+      (*calls)++;
+      return a == b;
+    }
+  };
+  std::vector<int> skewed(4000, 7);
+  skewed.insert(skewed.end(), 10, 3);
+  auto zs = zip::make_zip(skewed);
+  std::size_t calls = 0;
+  const zip::HashIndex<0, decltype(zs), std::hash<int>,
+                       counting_equal>
+      skewed_index(zs, {}, counting_equal{&calls});
+  std::vector<int> probe_keys(300);
+  std::vector<int> probe_rows(probe_keys.size());
+  for(std::size_t i = 0; i < probe_keys.size(); i++) {
+    probe_keys[i] = i % 3 == 0 ? 7 : i % 3 == 1 ? 3 : 5;
+    probe_rows[i] = static_cast<int>(i);
+  }
+  auto zp = zip::make_zip(probe_keys, probe_rows);
+  std::vector<int> semi_rows, anti_rows;
+  zip::hash_join<0, zip::join_type::semi>(
+      zp, skewed_index, [&](const auto &a) {
+        semi_rows.push_back(std::get<1>(a));
+      });
+  zip::hash_join<0, zip::join_type::anti>(
+      zp, skewed_index, [&](const auto &a) {
+        anti_rows.push_back(std::get<1>(a));
+      });
+  REQUIRE(semi_rows.size() == 200);
+  REQUIRE(anti_rows.size() == 100);
+  for(const int row : semi_rows) {
+    REQUIRE(row % 3 != 2);
+  }
+  for(const int row : anti_rows) {
+    REQUIRE(row % 3 == 2);
+  }
+  REQUIRE(std::is_sorted(semi_rows.begin(), semi_rows.end()));
+  REQUIRE(std::is_sorted(anti_rows.begin(), anti_rows.end()));
+
+  // The 7s were inserted first, so each probe finds one in
+  // its home slot
+  std::vector<int> sevens(100, 7);
+  calls = 0;
+  std::size_t emitted = 0;
+  zip::hash_join<0, zip::join_type::semi>(
+      zip::make_zip(sevens), skewed_index,
+      [&](const auto &) { emitted++; });
+  REQUIRE(emitted == sevens.size());
+  REQUIRE(calls == sevens.size());
+}
+
+TEST_CASE("group_by", "[Zip]") {
+  std::random_device rd;
+  std::mt19937_64 rng(rd());
+  std::uniform_int_distribution<int> key_pdf(0, 40);
+  std::uniform_int_distribution<int> value_pdf(-100, 100);
+  std::vector<int> keys(3000), values(3000);
+  for(auto [k, v] : zip::make_zip(keys, values)) {
+    k = key_pdf(rng);
+    v = value_pdf(rng);
+  }
+  struct stats {
+    std::size_t count = 0;
+    long sum = 0;
+    int min = 1000, max = -1000;
+  };
+  std::map<int, stats> expected;
+  for(auto [k, v] : zip::make_zip(keys, values)) {
+    auto &e = expected[k];
+    e.count++;
+    e.sum += v;
+    e.min = std::min(e.min, v);
+    e.max = std::max(e.max, v);
+  }
+  const auto check = [&](const auto &groups) {
+    REQUIRE(groups.size() == expected.size());
+    for(const auto &[k, count, sum, min, max, mean] : groups) {
+      const auto &e = expected.at(k);
+      REQUIRE(count == e.count);
+      REQUIRE(sum == e.sum);
+      REQUIRE(min == e.min);
+      REQUIRE(max == e.max);
+      REQUIRE(mean == Approx(static_cast<double>(e.sum) /
+                             static_cast<double>(e.count)));
+    }
+  };
+  auto z = zip::make_zip(keys, values);
+  for(unsigned threads : {1, 2, 5}) {
+    const zip::parallel_policy par{threads, 1};
+    // Unsorted, so the groups are in order of first row
+    const auto unsorted = zip::group_by<0>(
+        z, par, zip::count_of(), zip::sum_of<1>(),
+        zip::min_of<1>(), zip::max_of<1>(), zip::mean_of<1>());
+    check(unsorted);
+    REQUIRE(std::get<0>(unsorted[0]) == keys[0]);
+  }
+  std::sort(z.begin(), z.end(),
+            [](const decltype(z)::value_type &lhs,
+               const decltype(z)::value_type &rhs) {
+              return std::get<0>(lhs) < std::get<0>(rhs);
+            });
+  for(unsigned threads : {1, 3, 8}) {
+    const zip::parallel_policy par{threads, 1};
+    const auto sorted = zip::group_by<0>(
+        z, par, zip::count_of(), zip::sum_of<1>(),
+        zip::min_of<1>(), zip::max_of<1>(), zip::mean_of<1>());
+    check(sorted);
+    REQUIRE(std::is_sorted(sorted.begin(), sorted.end()));
+  }
+  const auto counts = zip::group_by<0>(z, zip::count_of());
+  REQUIRE(counts.size() == expected.size());
+}
+
+TEST_CASE("unique, unique_by", "[Zip]") {
+  std::vector<int> first{1, 1, 1, 2, 2, 3, 3, 3, 3, 4};
+  std::vector<int> second{5, 5, 6, 7, 7, 8, 8, 9, 8, 1};
+  std::vector<int> f(first), s(second);
+  auto z = zip::make_zip(f, s);
+  const auto n = zip::unique(z);
+  REQUIRE(n == 7);
+  f.resize(n);
+  s.resize(n);
+  REQUIRE((f == std::vector<int>{1, 1, 2, 3, 3, 3, 4}));
+  REQUIRE((s == std::vector<int>{5, 6, 7, 8, 9, 8, 1}));
+
+  f = first;
+  s = second;
+  const auto n_by = zip::unique_by<0>(
+      z, std::equal_to<>(), zip::parallel_policy{3, 1});
+  REQUIRE(n_by == 4);
+  REQUIRE((std::vector<int>(f.begin(), f.begin() + 4) ==
+           std::vector<int>{1, 2, 3, 4}));
+  REQUIRE((std::vector<int>(s.begin(), s.begin() + 4) ==
+           std::vector<int>{5, 7, 8, 1}));
+
+  std::vector<std::string> names{"a", "a", "b"};
+  auto zn = zip::make_zip(names);
+  REQUIRE(zip::unique(zn, [](const auto &lhs, const auto &rhs) {
+            return std::get<0>(lhs) == std::get<0>(rhs);
+          }) == 2);
+  REQUIRE(names[1] == "b");
+  std::vector<int> empty;
+  REQUIRE(zip::unique(zip::make_zip(empty)) == 0);
+}
+
+TEST_CASE("partition, stable_partition, nth_element, "
+          "partial_sort",
+          "[Zip]") {
+  std::random_device rd;
+  std::mt19937_64 rng(rd());
+  std::uniform_int_distribution<int> pdf(0, 1000);
+  std::vector<int> original(1001);
+  for(auto &k : original) {
+    k = pdf(rng);
+  }
+  std::vector<int> keys;
+  std::vector<std::string> names;
+  const auto reset = [&]() {
+    keys = original;
+    names.resize(keys.size());
+    for(std::size_t i = 0; i < keys.size(); i++) {
+      names[i] = std::to_string(keys[i]);
+    }
+  };
+  const auto rows_intact = [&]() {
+    for(std::size_t i = 0; i < keys.size(); i++) {
+      REQUIRE(names[i] == std::to_string(keys[i]));
+    }
+    std::vector<int> sorted(keys), sorted_original(original);
+    std::sort(sorted.begin(), sorted.end());
+    std::sort(sorted_original.begin(), sorted_original.end());
+    REQUIRE(sorted == sorted_original);
+  };
+  const auto even = [](const int k) { return k % 2 == 0; };
+  const auto num_even =
+      std::count_if(original.begin(), original.end(), even);
+
+  reset();
+  auto z = zip::make_zip(keys, names);
+  auto split = zip::partition<0>(z, even);
+  REQUIRE(split - z.begin() == num_even);
+  REQUIRE(std::all_of(keys.begin(), keys.begin() + num_even,
+                      even));
+  REQUIRE(std::none_of(keys.begin() + num_even, keys.end(),
+                       even));
+  rows_intact();
+
+  reset();
+  split = zip::stable_partition<0>(z, even);
+  REQUIRE(split - z.begin() == num_even);
+  std::vector<int> expected(original);
+  std::stable_partition(expected.begin(), expected.end(), even);
+  REQUIRE(keys == expected);
+  rows_intact();
+
+  reset();
+  const std::size_t median = keys.size() / 2;
+  zip::nth_element<0>(z, median);
+  std::vector<int> sorted(original);
+  std::sort(sorted.begin(), sorted.end());
+  REQUIRE(keys[median] == sorted[median]);
+  for(std::size_t i = 0; i < keys.size(); i++) {
+    REQUIRE((i < median ? keys[i] <= keys[median]
+                        : keys[i] >= keys[median]));
+  }
+  rows_intact();
+
+  reset();
+  zip::partial_sort<0>(z, 10, std::greater<>());
+  REQUIRE(std::equal(keys.begin(), keys.begin() + 10,
+                     sorted.rbegin()));
+  rows_intact();
+}
+
+TEST_CASE("top_k", "[Zip]") {
+  std::random_device rd;
+  std::mt19937_64 rng(rd());
+  std::uniform_int_distribution<int> pdf(0, 500);
+  std::vector<int> players(20000), scores(20000);
+  for(std::size_t i = 0; i < players.size(); i++) {
+    players[i] = static_cast<int>(i);
+    scores[i] = pdf(rng);
+  }
+  auto z = zip::make_zip(players, scores);
+  // Expected: by descending score, then ascending row
+  std::vector<std::size_t> order(players.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](const std::size_t lhs,
+                       const std::size_t rhs) {
+                     return scores[lhs] > scores[rhs];
+                   });
+  for(unsigned threads : {1, 2, 7}) {
+    const auto leaders = zip::top_k<1>(
+        z, 100, std::greater<>(),
+        zip::parallel_policy{threads, 1});
+    REQUIRE(leaders.size() == 100);
+    for(std::size_t i = 0; i < leaders.size(); i++) {
+      REQUIRE(leaders[i] == order[i]);
+    }
+    std::size_t i = 0;
+    for(auto [p, s] : zip::gather(z, leaders)) {
+      REQUIRE(p == static_cast<int>(order[i]));
+      REQUIRE(s == scores[order[i]]);
+      i++;
+    }
+  }
+  const auto lowest = zip::top_k<1>(z, 3);
+  REQUIRE(scores[lowest[0]] ==
+          *std::min_element(scores.begin(), scores.end()));
+  REQUIRE(zip::top_k<1>(z.take(5), 10).size() == 5);
+  REQUIRE(zip::top_k<1>(z, 0).empty());
+}
+
+TEST_CASE("histogram, weighted_histogram", "[Zip]") {
+  std::random_device rd;
+  std::mt19937_64 rng(rd());
+  std::uniform_real_distribution<double> pdf(-1.0, 11.0);
+  std::uniform_int_distribution<int> mass_pdf(1, 4);
+  std::vector<double> speed(5000), other(5000);
+  std::vector<int> mass(5000);
+  for(auto [s, o, m] : zip::make_zip(speed, other, mass)) {
+    s = pdf(rng);
+    o = pdf(rng);
+    m = mass_pdf(rng);
+  }
+  const zip::uniform_bins<double> bins{0.0, 10.0, 20};
+  std::vector<std::size_t> expected(20);
+  std::vector<double> expected_weights(20);
+  std::vector<std::size_t> expected_2d(20 * 5);
+  for(auto [s, o, m] : zip::make_zip(speed, other, mass)) {
+    if(s >= 0.0 && s < 10.0) {
+      const auto b = static_cast<std::size_t>(s * 2.0);
+      expected[b]++;
+      expected_weights[b] += m;
+      if(o >= 0.0 && o < 10.0) {
+        expected_2d[b * 5 + static_cast<std::size_t>(o / 2.0)]++;
+      }
+    }
+  }
+  auto z = zip::make_zip(speed, other, mass);
+  REQUIRE(zip::histogram<0>(z, bins) == expected);
+  REQUIRE(zip::histogram<0>(z, zip::deterministic, bins) ==
+          expected);
+  REQUIRE((zip::weighted_histogram<2, 0>(z, zip::deterministic,
+                                         bins) ==
+           expected_weights));
+  for(unsigned threads : {2, 3}) {
+    const zip::parallel_policy policy{threads, 1};
+    REQUIRE((zip::histogram<0>(z, policy, bins) == expected));
+    REQUIRE((zip::weighted_histogram<2, 0>(z, policy, bins) ==
+             expected_weights));
+    REQUIRE((zip::histogram<0, 1>(
+                 z, policy, bins,
+                 zip::uniform_bins<double>{0.0, 10.0, 5}) ==
+             expected_2d));
+  }
+  std::vector<int> ids{0, 1, 1, 2, 2, 2, 7};
+  REQUIRE((zip::histogram<0>(zip::make_zip(ids),
+                             zip::uniform_bins<int>{0, 4, 4}) ==
+           std::vector<std::size_t>{1, 2, 3, 0}));
+}
+
+TEST_CASE("radix_partition", "[Zip]") {
+  std::random_device rd;
+  std::mt19937_64 rng(rd());
+  std::uniform_int_distribution<int> pdf(0, 500);
+  std::vector<int> ids(3000);
+  std::vector<double> mass(ids.size());
+  std::vector<std::string> names(ids.size());
+  for(std::size_t i = 0; i < ids.size(); i++) {
+    ids[i] = pdf(rng);
+    mass[i] = static_cast<double>(i);
+    names[i] = std::to_string(ids[i]);
+  }
+  auto src = zip::make_zip(ids, mass, names);
+  for(unsigned bits : {0, 1, 5}) {
+    std::vector<int> seq_ids(ids.size());
+    std::vector<double> seq_mass(ids.size());
+    std::vector<std::string> seq_names(ids.size());
+    const auto offsets = zip::radix_partition<0>(
+        src, zip::make_zip(seq_ids, seq_mass, seq_names), bits);
+    REQUIRE(offsets.size() == (std::size_t(1) << bits) + 1);
+    REQUIRE(offsets.front() == 0);
+    REQUIRE(offsets.back() == ids.size());
+    std::map<int, std::size_t> partition_of;
+    for(std::size_t p = 0; p + 1 < offsets.size(); p++) {
+      for(std::size_t i = offsets[p]; i < offsets[p + 1]; i++) {
+        // Equal keys share a partition, and rows keep their
+        // order in it
+        REQUIRE(partition_of.emplace(seq_ids[i], p).first->second ==
+                p);
+        REQUIRE(seq_names[i] == std::to_string(seq_ids[i]));
+        REQUIRE(ids[static_cast<std::size_t>(seq_mass[i])] ==
+                seq_ids[i]);
+        if(i > offsets[p]) {
+          REQUIRE(seq_mass[i - 1] < seq_mass[i]);
+        }
+      }
+    }
+
+    const zip::parallel_policy policy{3, 1};
+    std::vector<int> par_ids(ids.size());
+    std::vector<double> par_mass(ids.size());
+    std::vector<std::string> par_names(ids.size());
+    REQUIRE(zip::radix_partition<0>(
+                src, zip::make_zip(par_ids, par_mass, par_names),
+                bits, policy) == offsets);
+    REQUIRE(par_ids == seq_ids);
+    REQUIRE(par_mass == seq_mass);
+    REQUIRE(par_names == seq_names);
+  }
+
+  std::vector<int> out_ids(ids.size());
+  std::vector<double> out_mass(ids.size());
+  std::vector<std::string> out_names(ids.size());
+  auto dest = zip::make_zip(out_ids, out_mass, out_names);
+  REQUIRE_THROWS_AS(zip::radix_partition<0>(src, dest, 17),
+                    const std::invalid_argument &);
+  REQUIRE_THROWS_AS(zip::radix_partition<0>(src, dest, 64),
+                    const std::invalid_argument &);
+}
+
+TEST_CASE("zone_map, filter", "[Zip]") {
+  std::random_device rd;
+  std::mt19937_64 rng(rd());
+  std::uniform_real_distribution<double> pdf(0.0, 1.0);
+  std::vector<double> time(2000), mass(time.size());
+  std::vector<int> id(time.size());
+  double t = 0.0;
+  for(std::size_t i = 0; i < time.size(); i++) {
+    t += pdf(rng);
+    time[i] = t;
+    mass[i] = pdf(rng);
+    id[i] = static_cast<int>(i);
+  }
+  auto z = zip::make_zip(time, mass, id);
+  auto zones = zip::zone_map<0, 1>(z, 64);
+  REQUIRE(zones.num_blocks() == 32);
+  REQUIRE(zones.bounds<0>(0).first == time[0]);
+  REQUIRE(zones.bounds<0>(0).second == time[63]);
+
+  const auto expected = [&](const double t0, const double t1,
+                            const double m) {
+    std::vector<int> ids;
+    for(auto [tm, ms, i] : z) {
+      if(tm >= t0 && tm <= t1 && ms <= m) {
+        ids.push_back(i);
+      }
+    }
+    return ids;
+  };
+  for(auto [t0, t1] : {std::pair<double, double>{100.0, 300.0},
+                       {-1.0, 5000.0},
+                       {2000.0, 3000.0}}) {
+    std::vector<int> plain, skipping;
+    const auto window = zip::between<0>(t0, t1);
+    const auto light = zip::between<1>(0.0, 0.5);
+    const auto n = zip::filter(
+        z, [&](auto row) { plain.push_back(std::get<2>(row)); },
+        window, light);
+    REQUIRE(zip::filter(
+                zones,
+                [&](auto row) {
+                  skipping.push_back(std::get<2>(row));
+                },
+                window, light) == n);
+    REQUIRE(plain == expected(t0, t1, 0.5));
+    REQUIRE(skipping == plain);
+  }
+
+  // Appended rows are scanned until the zone map is refreshed
+  for(int i = 0; i < 100; i++) {
+    time.push_back(t + 1.0 + i);
+    mass.push_back(0.25);
+    id.push_back(static_cast<int>(time.size() - 1));
+  }
+  const auto tail = zip::between<0>(t + 0.5, t + 200.0);
+  std::size_t visited = 0;
+  const auto count = [&](auto) { visited++; };
+  REQUIRE(zip::filter(zones, count, tail) == 100);
+  zones.refresh();
+  REQUIRE(zones.rows() == time.size());
+  REQUIRE(zones.num_blocks() == 33);
+  REQUIRE(zip::filter(zones, count, tail) == 100);
+  REQUIRE(zip::filter(zones, count, zip::equals<2>(5),
+                      zip::between<0>(-1.0, t + 200.0)) == 1);
+  REQUIRE(visited == 201);
+}
+
+TEST_CASE("Bitmask, for_each_set", "[Zip]") {
+  zip::Bitmask mask(130);
+  REQUIRE(mask.size() == 130);
+  REQUIRE(mask.count() == 0);
+  mask.set(0);
+  mask[64] = true;
+  mask[129] = mask[64];
+  REQUIRE(mask.test(129));
+  REQUIRE(mask.count() == 3);
+  mask.reset(0);
+  mask[64].flip();
+  REQUIRE(mask.count() == 1);
+  mask.push_back(true);
+  REQUIRE(mask.size() == 131);
+  REQUIRE(mask[130]);
+  mask.resize(200, true);
+  REQUIRE(mask.count() == 71);
+  mask.flip();
+  REQUIRE(mask.count() == 129);
+  REQUIRE(std::count(mask.cbegin(), mask.cend(), true) == 129);
+
+  std::random_device rd;
+  std::mt19937_64 rng(rd());
+  std::uniform_real_distribution<double> pdf(0.0, 1.0);
+  std::vector<double> x(1000);
+  std::vector<int> id(x.size());
+  for(std::size_t i = 0; i < x.size(); i++) {
+    x[i] = pdf(rng);
+    id[i] = static_cast<int>(i);
+  }
+  zip::Bitmask active(x.size());
+  for(auto [v, a] : zip::make_zip(x, active)) {
+    a = v < 0.1;
+  }
+  std::vector<int> expected;
+  for(auto [v, i] : zip::make_zip(x, id)) {
+    if(v < 0.1) {
+      expected.push_back(i);
+    }
+  }
+  REQUIRE(active.count() == expected.size());
+  std::vector<int> visited;
+  REQUIRE(zip::for_each_set(zip::make_zip(x, id), active,
+                            [&](auto row) {
+                              std::get<0>(row) = 1.0;
+                              visited.push_back(std::get<1>(row));
+                            }) == expected.size());
+  REQUIRE(visited == expected);
+  for(int i : expected) {
+    REQUIRE(x[i] == 1.0);
+  }
+
+  // Swaps exchange the bits rather than the proxies
+  std::vector<int> keys(1000);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::shuffle(keys.begin(), keys.end(), rng);
+  zip::Bitmask even(keys.size());
+  for(auto [k, e] : zip::make_zip(keys, even)) {
+    e = k % 2 == 0;
+  }
+  const auto matches = [](const std::vector<int> &k,
+                          const zip::Bitmask &e) {
+    for(std::size_t i = 0; i < k.size(); i++) {
+      if(e[i] != (k[i] % 2 == 0)) {
+        return false;
+      }
+    }
+    return e.count() == k.size() / 2;
+  };
+  auto keyed = zip::make_zip(keys, even);
+  std::sort(keyed.begin(), keyed.end(),
+            [](const auto &a, const auto &b) {
+              return std::get<0>(a) < std::get<0>(b);
+            });
+  REQUIRE(std::is_sorted(keys.begin(), keys.end()));
+  REQUIRE(matches(keys, even));
+
+  const auto middle =
+      zip::partition<1>(keyed, [](const bool e) { return e; });
+  REQUIRE(middle - keyed.begin() == 500);
+  REQUIRE(matches(keys, even));
+  REQUIRE(std::all_of(keys.begin(), keys.begin() + 500,
+                      [](int k) { return k % 2 == 0; }));
+
+  std::vector<int> part_keys(keys.size());
+  zip::Bitmask part_even(keys.size());
+  const auto offsets = zip::radix_partition<0>(
+      keyed, zip::make_zip(part_keys, part_even), 4,
+      zip::parallel_policy{3, 1});
+  REQUIRE(offsets.back() == keys.size());
+  REQUIRE(matches(part_keys, part_even));
+
+  // Parallel writes into a Bitmask do not race on the words
+  // shared by the chunks
+  const std::size_t num_rows = 65573;
+  const zip::parallel_policy par{4, 1};
+  std::vector<int> ids(num_rows);
+  std::iota(ids.begin(), ids.end(), 0);
+  std::vector<std::size_t> perm(num_rows);
+  std::iota(perm.begin(), perm.end(), 0);
+  std::shuffle(perm.begin(), perm.end(), rng);
+  zip::Bitmask odd(num_rows);
+  for(auto [i, o] : zip::make_zip(ids, odd)) {
+    o = i % 2 == 1;
+  }
+  std::vector<int> scattered_ids(num_rows);
+  zip::Bitmask scattered_odd(num_rows);
+  zip::scatter(zip::make_zip(ids, odd), perm,
+               zip::make_zip(scattered_ids, scattered_odd),
+               par);
+  REQUIRE(scattered_odd.count() == num_rows / 2);
+  for(std::size_t i = 0; i < num_rows; i++) {
+    REQUIRE(scattered_odd[i] == (scattered_ids[i] % 2 == 1));
+  }
+
+  zip::apply_permutation(
+      zip::make_zip(scattered_ids, scattered_odd), perm, par);
+  REQUIRE(scattered_ids == ids);
+  REQUIRE(scattered_odd.words() == odd.words());
+
+  zip::Bitmask any_odd(num_rows);
+  zip::inclusive_scan(
+      zip::make_zip(scattered_odd), zip::make_zip(any_odd),
+      [](const auto &a, const auto &b) {
+        return std::tuple<bool>(std::get<0>(a) ||
+                                std::get<0>(b));
+      },
+      par);
+  REQUIRE(!any_odd[0]);
+  REQUIRE(any_odd.count() == num_rows - 1);
+}
+
+TEST_CASE("Segments", "[Zip]") {
+  // Neighbor lists of a graph in compressed sparse row form
+  std::vector<std::size_t> offsets{0, 2, 2, 5, 6};
+  std::vector<int> neighbor_ids{1, 3, 0, 1, 3, 2};
+  std::vector<double> weights{0.5, 1.0, 2.0, 0.25, 4.0, 8.0};
+  auto graph =
+      zip::segments(offsets, zip::make_zip(neighbor_ids, weights));
+  REQUIRE(graph.size() == 4);
+  REQUIRE(!graph.empty());
+  REQUIRE(graph.rows().size() == 6);
+  REQUIRE(graph[1].empty());
+  REQUIRE(graph[2].size() == 3);
+  REQUIRE(std::get<0>(*graph[3].begin()) == 2);
+  REQUIRE(graph.end() - graph.begin() == 4);
+
+  std::vector<double> totals;
+  for(auto neighbors : graph) {
+    double total = 0.0;
+    for(auto [id, w] : neighbors) {
+      total += w * id;
+      w *= 2.0;
+    }
+    totals.push_back(total);
+  }
+  REQUIRE((totals == std::vector<double>{3.5, 0.0, 12.25, 16.0}));
+  REQUIRE(weights[5] == 16.0);
+
+  // Segments are Slices, so the algorithms apply per row
+  REQUIRE(zip::transform_reduce(
+              graph[2], 0.0, std::plus<>(),
+              [](const auto &row) { return std::get<1>(row); }) ==
+          12.5);
+
+  std::vector<std::size_t> none;
+  REQUIRE(zip::segments(none, zip::make_zip(neighbor_ids, weights))
+              .empty());
+}
+
+TEST_CASE("MappedColumns", "[Zip]") {
+  const std::string path = "zip_tests_mapped.cols";
+  std::vector<double> mass(1000);
+  std::vector<std::int32_t> id(mass.size());
+  for(std::size_t i = 0; i < mass.size(); i++) {
+    mass[i] = 0.5 * static_cast<double>(i);
+    id[i] = static_cast<std::int32_t>(i) - 500;
+  }
+  {
+    // Lay out the file by hand
+    using namespace zip_internal_;
+    const std::uint64_t mass_offset = columns_file_header_size(2);
+    const std::uint64_t id_offset =
+        mass_offset +
+        align_up(mass.size() * sizeof(double),
+                 columns_file_alignment);
+    columns_file_header header{{}, columns_file_version, 2,
+                               mass.size()};
+    std::memcpy(header.magic, columns_file_magic,
+                sizeof(header.magic));
+    const columns_file_column table[] = {
+        {mass_offset, sizeof(double)},
+        {id_offset, sizeof(std::int32_t)}};
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(&header),
+              sizeof(header));
+    out.write(reinterpret_cast<const char *>(table),
+              sizeof(table));
+    out.seekp(static_cast<std::streamoff>(mass_offset));
+    out.write(reinterpret_cast<const char *>(mass.data()),
+              mass.size() * sizeof(double));
+    out.seekp(static_cast<std::streamoff>(id_offset));
+    out.write(reinterpret_cast<const char *>(id.data()),
+              id.size() * sizeof(std::int32_t));
+  }
+
+  {
+    const zip::MappedColumns<double, std::int32_t> mapped(path);
+    REQUIRE(mapped.size() == mass.size());
+    REQUIRE(mapped.column<1>()[999] == 499);
+    auto z = mapped.zip();
+    REQUIRE(z.size() == mass.size());
+    REQUIRE(std::equal(z.begin(), z.end(),
+                       zip::make_zip(mass, id).begin()));
+    REQUIRE(zip::transform_reduce(
+                z, std::int64_t(0), std::plus<>(),
+                [](const auto &row) { return std::get<1>(row); }) ==
+            -500);
+    mapped.advise(zip::access_hint::random);
+    REQUIRE(std::get<0>(*(z.begin() + 10)) == 5.0);
+  }
+
+  REQUIRE_THROWS_AS((zip::MappedColumns<double>(path)),
+                    const std::runtime_error &);
+  REQUIRE_THROWS_AS((zip::MappedColumns<float, std::int32_t>(path)),
+                    const std::runtime_error &);
+  std::remove(path.c_str());
+  REQUIRE_THROWS_AS((zip::MappedColumns<double>(path)),
+                    const std::system_error &);
+}
+
+TEST_CASE("write_columns", "[Zip]") {
+  struct vec3 {
+    float x, y, z;
+  };
+  const std::string path = "zip_tests_written.cols";
+  std::vector<double> mass(5000);
+  std::vector<vec3> pos(mass.size());
+  zip::Bitmask active(mass.size());
+  for(std::size_t i = 0; i < mass.size(); i++) {
+    mass[i] = 0.25 * static_cast<double>(i);
+    const float f = static_cast<float>(i);
+    pos[i] = {f, -f, 2.0f * f};
+    active[i] = i % 3 == 0;
+  }
+  auto z = zip::make_zip(mass, pos, active);
+  for(const bool direct : {false, true}) {
+    // A small buffer makes the 12 byte values straddle its end
+    zip::write_options options;
+    options.buffer_size = 4096;
+    options.direct = direct;
+    options.sync = direct;
+    zip::write_columns(path, z, options);
+    const zip::MappedColumns<double, vec3, bool> mapped(path);
+    REQUIRE(mapped.size() == mass.size());
+    std::size_t i = 0;
+    for(auto [m, p, a] : mapped.zip()) {
+      REQUIRE(m == mass[i]);
+      REQUIRE(p.x == pos[i].x);
+      REQUIRE(p.y == pos[i].y);
+      REQUIRE(p.z == pos[i].z);
+      REQUIRE(a == active[i]);
+      i++;
+    }
+    REQUIRE(i == mass.size());
+  }
+
+  // Slices of zips are written as their own files
+  zip::write_columns(path, zip::project<0>(z).drop(4990));
+  const zip::MappedColumns<double> tail(path);
+  REQUIRE(tail.size() == 10);
+  REQUIRE(tail.column<0>()[0] == mass[4990]);
+  std::remove(path.c_str());
+}